@@ -61,10 +61,20 @@ struct AlphaBeta {
 
     /**
      * Checks if children can be pruned or not by looking at the range given
-     * in the transposition table.
+     * in the transposition table. An exact score (both limits equal) can
+     * always be used as is. Entries searched shallower than `depth' are
+     * never used: their limits say nothing about a deeper search.
+     *
+     * \param[in] entry the entry found in the transposition table.
+     *
+     * \param[in] team the team of the node to be examined.
+     *
+     * \param[in] depth the number of plies that would be searched under the
+     *                  node.
      */
     bool can_prune(const TranspositionTable::Entry& entry,
-                   const Who team) const;
+                   const Who team,
+                   const unsigned depth) const;
 
     /**
      * alpha = best max/home score
@@ -101,7 +111,14 @@ inline bool AlphaBeta::can_prune(const score_t score, const Who team) const {
 }
 
 inline bool AlphaBeta::can_prune(const TranspositionTable::Entry& entry,
-                                 const Who team) const {
+                                 const Who team,
+                                 const unsigned depth) const {
+    if (entry.depth < depth) {
+        return false;
+    }
+    if (entry.lower_limit == entry.upper_limit) {
+        return true;
+    }
     return team == Who::HOME
         ? beta <= entry.lower_limit
         : alpha >= entry.upper_limit;
@@ -0,0 +1,139 @@
+#ifndef BIT_PARALLEL_H_
+#define BIT_PARALLEL_H_
+
+#include <cstdint>
+
+/**
+ * Move generation and the features of EvalBitboard, written once for any
+ * type that holds a whole board the way Bitboard does: cell (r, c) at bit
+ * r * COLS + c, with the bitwise operators, shifts, any() and count() of
+ * Bitboard. Bitboard itself is the scalar version; BoardKernels has one per
+ * instruction set, each in its own file compiled for it.
+ *
+ * Nothing else is included here, so that the files compiled for an
+ * instruction set the CPU may not have do not emit any code shared with the
+ * rest of the program.
+ */
+
+/**
+ * Anchor cells of every move of one team.
+ *
+ * \param[in] empty the empty cells.
+ *
+ * \param[in] not_last every cell but those in the last column.
+ *
+ * \param[in] cols the columns of the board.
+ *
+ * \param[in] vertical true for AWAY's moves, false for HOME's.
+ */
+template <class Board>
+inline Board find_moves(const Board& empty,
+                        const Board& not_last,
+                        const unsigned cols,
+                        const bool vertical) {
+    if (vertical) {
+        return empty & (empty >> cols);
+    }
+    return empty & (empty >> 1) & not_last;
+}
+
+/**
+ * Counts the moves the raster scans of Evaluators.h take out of the given
+ * anchors, where the anchors `step' cells apart overlap: the first anchor of
+ * every run, then every second one.
+ *
+ * \param[in] anchors the anchors of the moves that fit.
+ *
+ * \param[in] step 1 for horizontal moves, COLS for vertical ones.
+ *
+ * \param[out] taken set to the anchors of the moves taken.
+ *
+ * \return the number of moves taken.
+ */
+template <class Board>
+inline unsigned take_disjoint(Board anchors,
+                              const unsigned step,
+                              Board& taken) {
+    taken = Board();
+    while (anchors.any()) {
+        const Board firsts = anchors & ~(anchors << step);
+        taken |= firsts;
+        anchors &= ~(firsts | (firsts << step));
+    }
+    return taken.count();
+}
+
+/**
+ * The four counts of EvalBitboard::Features, in the order of its members:
+ * HOME's reserved and open moves, then AWAY's.
+ *
+ * \param[in] empty the empty cells.
+ *
+ * \param[in] not_first every cell but those in the first column.
+ *
+ * \param[in] not_last every cell but those in the last column.
+ *
+ * \param[in] cols the columns of the board.
+ *
+ * \param[out] counts room for the four counts.
+ */
+template <class Board>
+inline void count_features(const Board& empty,
+                           const Board& not_first,
+                           const Board& not_last,
+                           const unsigned cols,
+                           int* counts) {
+    Board taken;
+
+    // HOME: nothing empty above either cell, nor below
+    const Board home = find_moves(empty, not_last, cols, false);
+    const Board beside_rows = (empty >> cols) | (empty >> (cols + 1))
+        | (empty << cols) | (empty << (cols - 1));
+    counts[0] = take_disjoint(home & ~beside_rows, 1, taken);
+    taken |= taken << 1;
+    counts[1] = take_disjoint(home & ~(taken | (taken >> 1)), 1, taken);
+
+    // AWAY: nothing empty left of either cell, nor right
+    const Board away = find_moves(empty, not_last, cols, true);
+    const Board beside_cols =
+        (((empty << 1) | (empty >> (cols - 1))) & not_first)
+        | (((empty >> 1) | (empty >> (cols + 1))) & not_last);
+    counts[2] = take_disjoint(away & ~beside_cols, cols, taken);
+    taken |= taken << cols;
+    counts[3] = take_disjoint(away & ~(taken | (taken >> cols)), cols, taken);
+}
+
+/*
+ * The versions compiled for each instruction set. Boards are passed as the
+ * words of Bitboard::w, all four of them; shifts must be below 64 bits, i.e.
+ * COLS + 1 < 64. Only BoardKernels calls these, once it has checked that
+ * the CPU can run them.
+ */
+
+void find_moves_sse2(const std::uint64_t* empty,
+                     const std::uint64_t* not_last,
+                     unsigned cols,
+                     bool vertical,
+                     std::uint64_t* moves);
+
+void count_features_sse2(const std::uint64_t* empty,
+                         const std::uint64_t* not_first,
+                         const std::uint64_t* not_last,
+                         unsigned cols,
+                         int* counts);
+
+void find_moves_avx2(const std::uint64_t* empty,
+                     const std::uint64_t* not_last,
+                     unsigned cols,
+                     bool vertical,
+                     std::uint64_t* moves);
+
+void count_features_avx2(const std::uint64_t* empty,
+                         const std::uint64_t* not_first,
+                         const std::uint64_t* not_last,
+                         unsigned cols,
+                         int* counts);
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,68 @@
+#include "BoardKernels.h"
+#include "BitParallel.h"
+
+#include <stdexcept>
+#include <string>
+
+bool BoardKernels::supported(const Isa isa) {
+    switch (isa) {
+    case Isa::SCALAR:
+        return true;
+#if defined(__x86_64__)
+    case Isa::SSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2")
+            && __builtin_cpu_supports("popcnt");
+    case Isa::AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2")
+            && __builtin_cpu_supports("popcnt");
+#endif
+    default:
+        return false;
+    }
+}
+
+BoardKernels::Isa BoardKernels::best() {
+    if (supported(Isa::AVX2)) {
+        return Isa::AVX2;
+    }
+    if (supported(Isa::SSE2)) {
+        return Isa::SSE2;
+    }
+    return Isa::SCALAR;
+}
+
+const char* BoardKernels::name(const Isa isa) {
+    switch (isa) {
+    case Isa::SSE2:
+        return "sse2";
+    case Isa::AVX2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+BoardKernels::BoardKernels(const Isa isa)
+    : isa_{isa}
+    , find_moves_simd{nullptr}
+    , count_features_simd{nullptr}
+{
+    if (!supported(isa)) {
+        throw std::invalid_argument(
+                std::string(name(isa)) + " is not supported by this CPU");
+    }
+#if defined(__x86_64__)
+    if (isa == Isa::SSE2) {
+        find_moves_simd = find_moves_sse2;
+        count_features_simd = count_features_sse2;
+    }
+    else if (isa == Isa::AVX2) {
+        find_moves_simd = find_moves_avx2;
+        count_features_simd = count_features_avx2;
+    }
+#endif
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,124 @@
+#ifndef BOARD_KERNELS_H_
+#define BOARD_KERNELS_H_
+
+#include "Bitboard.h"
+#include "DomineeringState.h"
+#include "Evaluators.h"
+
+/**
+ * Move generation and EvalBitboard's features with the whole board in SIMD
+ * registers: two 128-bit SSE2 registers, or one 256-bit AVX2 register, hold
+ * any board up to 16x16. The algorithm is the one in BitParallel.h; only the
+ * register type differs.
+ *
+ * Each instruction set has its own file, compiled for it, and is only
+ * called on CPUs that report it at run time. Boards whose rows are too long
+ * for the shifts of the SIMD versions (COLS + 1 >= 64) always use the
+ * scalar one.
+ */
+class BoardKernels {
+public:
+    enum class Isa {
+        /* Bitboard, a word at a time */
+        SCALAR,
+        /* Two 128-bit registers */
+        SSE2,
+        /* One 256-bit register */
+        AVX2
+    };
+
+    /**
+     * \return true if the CPU can run the given version.
+     */
+    static bool supported(const Isa isa);
+
+    /**
+     * \return the fastest version the CPU can run.
+     */
+    static Isa best();
+
+    /**
+     * \return the name of a version, in lower case.
+     */
+    static const char* name(const Isa isa);
+
+    /**
+     * \param[in] isa the version to use.
+     *
+     * \throws std::invalid_argument if the CPU cannot run it.
+     */
+    explicit BoardKernels(const Isa isa = best());
+
+    /**
+     * \return the version in use.
+     */
+    Isa isa() const;
+
+    /**
+     * Same as DomineeringState::movesFor.
+     */
+    Bitboard moves(const DomineeringState& state, const Who who) const;
+
+    /**
+     * Same as bitboard_eval.
+     */
+    EvalBitboard::Features features(const DomineeringState& state) const;
+
+private:
+    using find_moves_t = void (*)(const std::uint64_t*,
+                                  const std::uint64_t*,
+                                  unsigned,
+                                  bool,
+                                  std::uint64_t*);
+    using count_features_t = void (*)(const std::uint64_t*,
+                                      const std::uint64_t*,
+                                      const std::uint64_t*,
+                                      unsigned,
+                                      int*);
+
+    Isa isa_;
+
+    /* The SIMD version, or nullptr for SCALAR */
+    find_moves_t find_moves_simd;
+    count_features_t count_features_simd;
+
+    /**
+     * \return true if the SIMD version can be used on the state's board.
+     */
+    bool use_simd(const DomineeringState& state) const;
+};
+
+inline BoardKernels::Isa BoardKernels::isa() const {
+    return isa_;
+}
+
+inline bool BoardKernels::use_simd(const DomineeringState& state) const {
+    return find_moves_simd != nullptr && state.COLS + 1 < 64;
+}
+
+inline Bitboard BoardKernels::moves(const DomineeringState& state,
+        const Who who) const {
+    if (!use_simd(state)) {
+        return state.movesFor(who);
+    }
+    Bitboard moves;
+    find_moves_simd(state.getEmpty().w, state.getNotLastColumn().w,
+            state.COLS, who == Who::AWAY, moves.w);
+    return moves;
+}
+
+inline EvalBitboard::Features BoardKernels::features(
+        const DomineeringState& state) const {
+    if (!use_simd(state)) {
+        return bitboard_eval(state);
+    }
+    int counts[4];
+    count_features_simd(state.getEmpty().w, state.getNotFirstColumn().w,
+            state.getNotLastColumn().w, state.COLS, counts);
+    return EvalBitboard::Features{counts[0], counts[1], counts[2],
+                                  counts[3]};
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
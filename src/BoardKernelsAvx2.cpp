@@ -0,0 +1,119 @@
+/*
+ * BitParallel.h with the whole board in one 256-bit AVX2 register. Compiled
+ * with -mavx2 -mpopcnt; BoardKernels only calls in here on CPUs that have
+ * both.
+ */
+
+#include "BitParallel.h"
+
+#if defined(__x86_64__)
+
+#include <immintrin.h>
+
+namespace {
+
+/**
+ * A board in one register: word i of Bitboard::w in 64-bit lane i.
+ */
+struct Avx2Board {
+    Avx2Board()
+        : v{_mm256_setzero_si256()}
+    { }
+
+    explicit Avx2Board(const __m256i v)
+        : v{v}
+    { }
+
+    static Avx2Board load(const std::uint64_t* words) {
+        return Avx2Board(_mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(words)));
+    }
+
+    void store(std::uint64_t* words) const {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(words), v);
+    }
+
+    bool any() const {
+        return !_mm256_testz_si256(v, v);
+    }
+
+    unsigned count() const {
+        return _mm_popcnt_u64(_mm256_extract_epi64(v, 0))
+            + _mm_popcnt_u64(_mm256_extract_epi64(v, 1))
+            + _mm_popcnt_u64(_mm256_extract_epi64(v, 2))
+            + _mm_popcnt_u64(_mm256_extract_epi64(v, 3));
+    }
+
+    Avx2Board operator&(const Avx2Board& o) const {
+        return Avx2Board(_mm256_and_si256(v, o.v));
+    }
+
+    Avx2Board operator|(const Avx2Board& o) const {
+        return Avx2Board(_mm256_or_si256(v, o.v));
+    }
+
+    Avx2Board operator~() const {
+        return Avx2Board(_mm256_xor_si256(v, _mm256_set1_epi64x(-1)));
+    }
+
+    Avx2Board& operator&=(const Avx2Board& o) {
+        v = _mm256_and_si256(v, o.v);
+        return *this;
+    }
+
+    Avx2Board& operator|=(const Avx2Board& o) {
+        v = _mm256_or_si256(v, o.v);
+        return *this;
+    }
+
+    /**
+     * Towards lower cells, by less than 64. Each lane takes the bits that
+     * leave the lane above it.
+     */
+    Avx2Board operator>>(const unsigned n) const {
+        // Lane i of `above' is lane i + 1, and 0 for the top lane
+        const __m256i above = _mm256_alignr_epi8(
+                _mm256_permute2x128_si256(v, v, 0x81), v, 8);
+        return Avx2Board(_mm256_or_si256(
+                    _mm256_srl_epi64(v, _mm_cvtsi32_si128(n)),
+                    _mm256_sll_epi64(above, _mm_cvtsi32_si128(64 - n))));
+    }
+
+    /**
+     * Towards higher cells, by less than 64.
+     */
+    Avx2Board operator<<(const unsigned n) const {
+        // Lane i of `below' is lane i - 1, and 0 for the bottom lane
+        const __m256i below = _mm256_alignr_epi8(
+                v, _mm256_permute2x128_si256(v, v, 0x08), 8);
+        return Avx2Board(_mm256_or_si256(
+                    _mm256_sll_epi64(v, _mm_cvtsi32_si128(n)),
+                    _mm256_srl_epi64(below, _mm_cvtsi32_si128(64 - n))));
+    }
+
+    __m256i v;
+};
+
+} // namespace
+
+void find_moves_avx2(const std::uint64_t* empty,
+        const std::uint64_t* not_last,
+        const unsigned cols,
+        const bool vertical,
+        std::uint64_t* moves) {
+    find_moves(Avx2Board::load(empty), Avx2Board::load(not_last), cols,
+            vertical).store(moves);
+}
+
+void count_features_avx2(const std::uint64_t* empty,
+        const std::uint64_t* not_first,
+        const std::uint64_t* not_last,
+        const unsigned cols,
+        int* counts) {
+    count_features(Avx2Board::load(empty), Avx2Board::load(not_first),
+            Avx2Board::load(not_last), cols, counts);
+}
+
+#endif
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
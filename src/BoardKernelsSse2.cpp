@@ -0,0 +1,141 @@
+/*
+ * BitParallel.h with the board in two 128-bit SSE2 registers. Compiled with
+ * -msse2 -mpopcnt; BoardKernels only calls in here on CPUs that have both.
+ */
+
+#include "BitParallel.h"
+
+#if defined(__x86_64__)
+
+#include <emmintrin.h>
+#include <nmmintrin.h>
+
+namespace {
+
+/**
+ * Population count of the two lanes of a register.
+ */
+inline unsigned popcount(const __m128i v) {
+    return _mm_popcnt_u64(_mm_cvtsi128_si64(v))
+        + _mm_popcnt_u64(_mm_cvtsi128_si64(_mm_unpackhi_epi64(v, v)));
+}
+
+/**
+ * A board in two registers: words 0 and 1 of Bitboard::w in `lo', 2 and 3
+ * in `hi'.
+ */
+struct Sse2Board {
+    Sse2Board()
+        : lo{_mm_setzero_si128()}
+        , hi{_mm_setzero_si128()}
+    { }
+
+    Sse2Board(const __m128i lo, const __m128i hi)
+        : lo{lo}
+        , hi{hi}
+    { }
+
+    static Sse2Board load(const std::uint64_t* words) {
+        return Sse2Board(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(words)),
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + 2)));
+    }
+
+    void store(std::uint64_t* words) const {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(words), lo);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(words + 2), hi);
+    }
+
+    bool any() const {
+        const __m128i both = _mm_or_si128(lo, hi);
+        return _mm_movemask_epi8(
+                _mm_cmpeq_epi32(both, _mm_setzero_si128())) != 0xffff;
+    }
+
+    unsigned count() const {
+        return popcount(lo) + popcount(hi);
+    }
+
+    Sse2Board operator&(const Sse2Board& o) const {
+        return Sse2Board(_mm_and_si128(lo, o.lo), _mm_and_si128(hi, o.hi));
+    }
+
+    Sse2Board operator|(const Sse2Board& o) const {
+        return Sse2Board(_mm_or_si128(lo, o.lo), _mm_or_si128(hi, o.hi));
+    }
+
+    Sse2Board operator~() const {
+        const __m128i ones = _mm_set1_epi32(-1);
+        return Sse2Board(_mm_xor_si128(lo, ones), _mm_xor_si128(hi, ones));
+    }
+
+    Sse2Board& operator&=(const Sse2Board& o) {
+        return *this = *this & o;
+    }
+
+    Sse2Board& operator|=(const Sse2Board& o) {
+        return *this = *this | o;
+    }
+
+    /**
+     * Towards lower cells, by less than 64. Each lane takes the bits that
+     * leave the lane above it.
+     */
+    Sse2Board operator>>(const unsigned n) const {
+        const __m128i right = _mm_cvtsi32_si128(n);
+        const __m128i left = _mm_cvtsi32_si128(64 - n);
+        // The lanes above those of `lo' and `hi'
+        const __m128i above_lo =
+            _mm_or_si128(_mm_srli_si128(lo, 8), _mm_slli_si128(hi, 8));
+        const __m128i above_hi = _mm_srli_si128(hi, 8);
+        return Sse2Board(
+                _mm_or_si128(_mm_srl_epi64(lo, right),
+                             _mm_sll_epi64(above_lo, left)),
+                _mm_or_si128(_mm_srl_epi64(hi, right),
+                             _mm_sll_epi64(above_hi, left)));
+    }
+
+    /**
+     * Towards higher cells, by less than 64.
+     */
+    Sse2Board operator<<(const unsigned n) const {
+        const __m128i left = _mm_cvtsi32_si128(n);
+        const __m128i right = _mm_cvtsi32_si128(64 - n);
+        // The lanes below those of `lo' and `hi'
+        const __m128i below_lo = _mm_slli_si128(lo, 8);
+        const __m128i below_hi =
+            _mm_or_si128(_mm_slli_si128(hi, 8), _mm_srli_si128(lo, 8));
+        return Sse2Board(
+                _mm_or_si128(_mm_sll_epi64(lo, left),
+                             _mm_srl_epi64(below_lo, right)),
+                _mm_or_si128(_mm_sll_epi64(hi, left),
+                             _mm_srl_epi64(below_hi, right)));
+    }
+
+    __m128i lo;
+    __m128i hi;
+};
+
+} // namespace
+
+void find_moves_sse2(const std::uint64_t* empty,
+        const std::uint64_t* not_last,
+        const unsigned cols,
+        const bool vertical,
+        std::uint64_t* moves) {
+    find_moves(Sse2Board::load(empty), Sse2Board::load(not_last), cols,
+            vertical).store(moves);
+}
+
+void count_features_sse2(const std::uint64_t* empty,
+        const std::uint64_t* not_first,
+        const std::uint64_t* not_last,
+        const unsigned cols,
+        int* counts) {
+    count_features(Sse2Board::load(empty), Sse2Board::load(not_first),
+            Sse2Board::load(not_last), cols, counts);
+}
+
+#endif
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -1,6 +1,7 @@
 #ifndef EVALUATORS_H_
 #define EVALUATORS_H_
 
+#include "BitParallel.h"
 #include "DomineeringState.h"
 
 #include <functional>
@@ -226,6 +227,51 @@ static const EvalAwayReserved away_reserved = EvalAwayReserved();
 static const EvalAwayOpen away_open = EvalAwayOpen();
 static const ClearMarks clear_marks = ClearMarks();
 
+/**
+ * The same features as the evaluators above, from the bitboard of empty
+ * cells: no copy of the state, no marks, one pass of shifts and masks per
+ * feature.
+ *
+ * The scans above take moves greedily in board order, and a mark only
+ * matters to the moves that overlap the marked domino: a reserved move that
+ * ends next to an earlier one would have to be empty where the earlier one
+ * needed a filled cell. So each feature is the set of anchors where the
+ * move fits, and the greedy count over it, where a run of k anchors in a
+ * row (or a column, for AWAY) gives ceil(k / 2) disjoint moves. See
+ * count_features in BitParallel.h; BoardKernels has the same with SIMD
+ * registers.
+ */
+struct EvalBitboard : public Evaluator {
+    /**
+     * The four counts, as home_reserved, home_open, away_reserved and
+     * away_open would give them.
+     */
+    struct Features {
+        score_t home_reserved;
+        score_t home_open;
+        score_t away_reserved;
+        score_t away_open;
+
+        /**
+         * \return the score of the position, as Searcher::evaluate gives
+         *         it.
+         */
+        score_t score() const {
+            return RESERVED_FACTOR * home_reserved + OPEN_FACTOR * home_open
+                - RESERVED_FACTOR * away_reserved - OPEN_FACTOR * away_open;
+        }
+    };
+
+    Features operator()(const DS& state) const {
+        int counts[4];
+        count_features(state.getEmpty(), state.getNotFirstColumn(),
+                       state.getNotLastColumn(), state.COLS, counts);
+        return Features{counts[0], counts[1], counts[2], counts[3]};
+    }
+};
+
+static const EvalBitboard bitboard_eval = EvalBitboard();
+
 #endif /* end of include guard */
 
 /* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,181 @@
+#include "IncrementalEvaluator.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+const unsigned IncrementalEvaluator::MAX_LINE;
+
+IncrementalEvaluator::IncrementalEvaluator()
+    : rows{0}
+    , cols{0}
+    , totals{0, 0, 0, 0}
+    , undo_size{0}
+{
+}
+
+IncrementalEvaluator::IncrementalEvaluator(const DomineeringState& state)
+    : rows{static_cast<unsigned>(state.ROWS)}
+    , cols{static_cast<unsigned>(state.COLS)}
+    , row_empty(rows, 0)
+    , col_empty(cols, 0)
+    , row_shares(rows)
+    , col_shares(cols)
+    , totals{0, 0, 0, 0}
+    , undo(DomineeringState::maxPlies(rows, cols))
+    , undo_size{0}
+{
+    if (rows > MAX_LINE || cols > MAX_LINE) {
+        throw std::length_error("board too long for IncrementalEvaluator");
+    }
+
+    const Bitboard& empty = state.getEmpty();
+    for (unsigned r = 0; r < rows; r++) {
+        for (unsigned c = 0; c < cols; c++) {
+            if (empty.test(r * cols + c)) {
+                row_empty[r] |= line_t{1} << c;
+                col_empty[c] |= line_t{1} << r;
+            }
+        }
+    }
+
+    for (unsigned r = 0; r < rows; r++) {
+        row_shares[r] = count_row(r);
+        totals.home_reserved += row_shares[r].reserved;
+        totals.home_open += row_shares[r].open;
+    }
+    for (unsigned c = 0; c < cols; c++) {
+        col_shares[c] = count_col(c);
+        totals.away_reserved += col_shares[c].reserved;
+        totals.away_open += col_shares[c].open;
+    }
+}
+
+void IncrementalEvaluator::tap(const Move move) {
+    if (!active()) {
+        return;
+    }
+    const unsigned r = move.cell() / cols;
+    const unsigned c = move.cell() % cols;
+    if (move.vertical()) {
+        row_empty[r] &= ~(line_t{1} << c);
+        row_empty[r + 1] &= ~(line_t{1} << c);
+        col_empty[c] &= ~(line_t{3} << r);
+    }
+    else {
+        row_empty[r] &= ~(line_t{3} << c);
+        col_empty[c] &= ~(line_t{1} << r);
+        col_empty[c + 1] &= ~(line_t{1} << r);
+    }
+
+    unsigned first_row, last_row, first_col, last_col;
+    affected(move, first_row, last_row, first_col, last_col);
+
+    Undo& saved = undo[undo_size++];
+    saved.totals = totals;
+    for (unsigned i = first_row; i <= last_row; i++) {
+        const Share share = count_row(i);
+        saved.rows[i - first_row] = row_shares[i];
+        totals.home_reserved += share.reserved - row_shares[i].reserved;
+        totals.home_open += share.open - row_shares[i].open;
+        row_shares[i] = share;
+    }
+    for (unsigned i = first_col; i <= last_col; i++) {
+        const Share share = count_col(i);
+        saved.cols[i - first_col] = col_shares[i];
+        totals.away_reserved += share.reserved - col_shares[i].reserved;
+        totals.away_open += share.open - col_shares[i].open;
+        col_shares[i] = share;
+    }
+}
+
+void IncrementalEvaluator::untap(const Move move) {
+    if (!active()) {
+        return;
+    }
+    const unsigned r = move.cell() / cols;
+    const unsigned c = move.cell() % cols;
+    if (move.vertical()) {
+        row_empty[r] |= line_t{1} << c;
+        row_empty[r + 1] |= line_t{1} << c;
+        col_empty[c] |= line_t{3} << r;
+    }
+    else {
+        row_empty[r] |= line_t{3} << c;
+        col_empty[c] |= line_t{1} << r;
+        col_empty[c + 1] |= line_t{1} << r;
+    }
+
+    unsigned first_row, last_row, first_col, last_col;
+    affected(move, first_row, last_row, first_col, last_col);
+
+    const Undo& saved = undo[--undo_size];
+    totals = saved.totals;
+    std::copy(saved.rows, saved.rows + (last_row - first_row + 1),
+              row_shares.begin() + first_row);
+    std::copy(saved.cols, saved.cols + (last_col - first_col + 1),
+              col_shares.begin() + first_col);
+}
+
+/* Private methods */
+
+IncrementalEvaluator::Share IncrementalEvaluator::count_line(
+        const line_t before,
+        const line_t line,
+        const line_t after) {
+    // Same as EvalBitboard, one line at a time: a move fits where two
+    // neighbouring cells are empty, and is reserved when the cells next to
+    // both are filled (or off the board) on either side
+    const line_t anchors = line & (line >> 1);
+    const line_t beside = before | (before >> 1) | after | (after >> 1);
+
+    Share share;
+    line_t taken;
+    share.reserved = take_disjoint(anchors & ~beside, taken);
+    taken |= taken << 1;
+    share.open = take_disjoint(anchors & ~(taken | (taken >> 1)), taken);
+    return share;
+}
+
+IncrementalEvaluator::score_t IncrementalEvaluator::take_disjoint(
+        line_t anchors,
+        line_t& taken) {
+    taken = 0;
+    while (anchors) {
+        const line_t firsts = anchors & ~(anchors << 1);
+        taken |= firsts;
+        anchors &= ~(firsts | (firsts << 1));
+    }
+    return __builtin_popcountll(taken);
+}
+
+IncrementalEvaluator::Share IncrementalEvaluator::count_row(
+        const unsigned r) const {
+    return count_line(r > 0 ? row_empty[r - 1] : 0,
+                      row_empty[r],
+                      r + 1 < rows ? row_empty[r + 1] : 0);
+}
+
+IncrementalEvaluator::Share IncrementalEvaluator::count_col(
+        const unsigned c) const {
+    return count_line(c > 0 ? col_empty[c - 1] : 0,
+                      col_empty[c],
+                      c + 1 < cols ? col_empty[c + 1] : 0);
+}
+
+void IncrementalEvaluator::affected(const Move move,
+        unsigned& first_row,
+        unsigned& last_row,
+        unsigned& first_col,
+        unsigned& last_col) const {
+    const unsigned r = move.cell() / cols;
+    const unsigned c = move.cell() % cols;
+    // The cells the move covers, then one more on each side
+    const unsigned height = move.vertical() ? 2 : 1;
+    const unsigned width = move.vertical() ? 1 : 2;
+    first_row = r > 0 ? r - 1 : 0;
+    last_row = std::min(r + height, rows - 1);
+    first_col = c > 0 ? c - 1 : 0;
+    last_col = std::min(c + width, cols - 1);
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
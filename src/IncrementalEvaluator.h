@@ -0,0 +1,185 @@
+#ifndef INCREMENTAL_EVALUATOR_H_
+#define INCREMENTAL_EVALUATOR_H_
+
+#include "DomineeringState.h"
+#include "Evaluators.h"
+#include "Move.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * The features of EvalBitboard, kept up to date as moves are made and taken
+ * back instead of counted from scratch at every leaf.
+ *
+ * HOME's features are a sum over the rows, and a row's share only depends
+ * on the empty cells of the row and of the two rows next to it. AWAY's are
+ * the same over the columns. A domino changes two cells, so only the shares
+ * of the (at most four) rows and columns around it are counted again; the
+ * shares they had are pushed onto an undo stack, and taken back from it.
+ *
+ * Every search thread has its own, next to the state it taps moves onto.
+ * All memory is taken when the object is made; tap and untap never
+ * allocate.
+ */
+class IncrementalEvaluator {
+public:
+    using score_t = Evaluator::score_t;
+
+    /**
+     * The empty cells of a row or a column, one bit per cell.
+     */
+    using line_t = std::uint64_t;
+
+    /**
+     * Longest row or column that fits in a line_t.
+     */
+    static const unsigned MAX_LINE = 64;
+
+    /**
+     * An evaluator that keeps nothing: tap and untap do nothing, for
+     * searchers that evaluate leaves from scratch.
+     */
+    IncrementalEvaluator();
+
+    /**
+     * Counts the features of a position from scratch.
+     *
+     * \param[in] state the position.
+     *
+     * \throws std::length_error if a row or a column of the board is longer
+     *                           than MAX_LINE.
+     */
+    explicit IncrementalEvaluator(const DomineeringState& state);
+
+    /**
+     * \return false if the evaluator keeps nothing.
+     */
+    bool active() const;
+
+    /**
+     * Places a domino.
+     *
+     * \param[in] move the move; both of its cells must be empty.
+     */
+    void tap(const Move move);
+
+    /**
+     * Takes back the last domino placed by tap.
+     *
+     * \param[in] move the move that was made.
+     */
+    void untap(const Move move);
+
+    /**
+     * \return the counts of the position, as bitboard_eval would give them.
+     */
+    const EvalBitboard::Features& features() const;
+
+    /**
+     * \return the score of the position, as Searcher::evaluate gives it.
+     */
+    score_t score() const;
+
+private:
+    /**
+     * One row's share of HOME's counts, or one column's share of AWAY's.
+     */
+    struct Share {
+        score_t reserved;
+        score_t open;
+    };
+
+    /**
+     * What a tap changed, besides the empty cells.
+     */
+    struct Undo {
+        EvalBitboard::Features totals;
+        Share rows[4];
+        Share cols[4];
+    };
+
+    unsigned rows;
+    unsigned cols;
+
+    /* Empty cells of each row, bit c for column c */
+    std::vector<line_t> row_empty;
+
+    /* Empty cells of each column, bit r for row r */
+    std::vector<line_t> col_empty;
+
+    /* HOME's counts in each row */
+    std::vector<Share> row_shares;
+
+    /* AWAY's counts in each column */
+    std::vector<Share> col_shares;
+
+    EvalBitboard::Features totals;
+
+    /* One entry per move tapped and not untapped yet */
+    std::vector<Undo> undo;
+    unsigned undo_size;
+
+    /**
+     * Counts the moves of one line that lie along it, the way
+     * take_disjoint in BitParallel.h does for the whole board.
+     *
+     * \param[in] before the empty cells of the line before, or 0.
+     *
+     * \param[in] line the empty cells of the line.
+     *
+     * \param[in] after the empty cells of the line after, or 0.
+     *
+     * \return the line's share.
+     */
+    static Share count_line(const line_t before,
+                            const line_t line,
+                            const line_t after);
+
+    /**
+     * Number of moves taken greedily from the anchors of one line, the
+     * first of every run and every second one after it.
+     *
+     * \param[in] anchors the anchors of the moves that fit.
+     *
+     * \param[out] taken set to the anchors of the moves taken.
+     */
+    static score_t take_disjoint(line_t anchors, line_t& taken);
+
+    /**
+     * Counts the share of a row again.
+     */
+    Share count_row(const unsigned r) const;
+
+    /**
+     * Counts the share of a column again.
+     */
+    Share count_col(const unsigned c) const;
+
+    /**
+     * The rows and columns whose shares a move changes: the ones it covers
+     * and the ones next to them, within the board.
+     */
+    void affected(const Move move,
+                  unsigned& first_row,
+                  unsigned& last_row,
+                  unsigned& first_col,
+                  unsigned& last_col) const;
+};
+
+inline const EvalBitboard::Features&
+IncrementalEvaluator::features() const {
+    return totals;
+}
+
+inline bool IncrementalEvaluator::active() const {
+    return !undo.empty();
+}
+
+inline IncrementalEvaluator::score_t IncrementalEvaluator::score() const {
+    return totals.score();
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,52 @@
+#include "MappedFile.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* Constructors and destructor {{{ */
+MappedFile::MappedFile()
+    : mapping{nullptr}
+    , bytes{0}
+{
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+/* }}} */
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    // The mapping stays valid without the descriptor
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return false;
+    }
+
+    mapping = p;
+    bytes = st.st_size;
+    return true;
+}
+
+void MappedFile::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, bytes);
+    }
+    mapping = nullptr;
+    bytes = 0;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,63 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <string>
+
+/**
+ * A file mapped read-only into memory. The contents are loaded by the
+ * operating system as they are touched, and shared with every other process
+ * that maps the same file.
+ */
+class MappedFile {
+public:
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * Maps the given file. A file that was mapped before is unmapped first.
+     *
+     * \param[in] path the file to map.
+     *
+     * \return false if the file cannot be read or is empty.
+     */
+    bool open(const std::string& path);
+
+    void close();
+
+    bool is_open() const;
+
+    /**
+     * \return the start of the file, or nullptr if it is not open.
+     */
+    const void* data() const;
+
+    /**
+     * \return the size of the file in bytes.
+     */
+    std::size_t size() const;
+
+private:
+    void* mapping;
+    std::size_t bytes;
+};
+
+inline bool MappedFile::is_open() const {
+    return mapping != nullptr;
+}
+
+inline const void* MappedFile::data() const {
+    return mapping;
+}
+
+inline std::size_t MappedFile::size() const {
+    return bytes;
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
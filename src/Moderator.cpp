@@ -1,4 +1,7 @@
 #include "Moderator.h"
+#include "Settings.h"
+
+#include <iostream>
 
 /* Constructors, destructor, and assignment operator {{{ */
 Moderator::Moderator()
@@ -38,18 +41,55 @@ Moderator& Moderator::operator=(const Moderator& other) {
 /* }}} */
 
 void Moderator::init() {
-    // Do nothing
+    if (Settings::get().save_table()) {
+        searcher.load_table(TranspositionTable::default_path());
+    }
+    if (Settings::get().report()) {
+        searcher.set_report(&std::cerr);
+    }
+    // Optional: without it, regions are solved as they come up
+    searcher.load_tablebase(Tablebase::default_path());
+    book.open(OpeningBook::default_path());
 }
 
 void Moderator::done() {
     searcher.cleanup();
+    if (Settings::get().save_table()) {
+        searcher.save_table(TranspositionTable::default_path());
+    }
+}
+
+void Moderator::startGame(std::string opponent_name) {
+    const Params& params = tournamentParams();
+    const float game_time = params.isDefined("GAMETIME")
+        ? params.intValue("GAMETIME") : 240;
+    const float move_time = params.isDefined("MOVETIME")
+        ? params.intValue("MOVETIME") : game_time;
+    searcher.new_game(game_time, move_time);
+}
+
+void Moderator::timeOfLastMove(double secs) {
+    searcher.server_time(secs);
+}
+
+void Moderator::endGame(int result) {
+    searcher.stop_pondering();
 }
 
 DomineeringMove Moderator::next_move(const DomineeringState& state) {
     // Set the starting node
     searcher.set_root(Node(state.getWho(), 0));
 
-    Node best_child = searcher.search(state, get_search_depth(state));
+    // Every game starts from the same board, so the first moves were
+    // searched long before the game
+    Location book_move;
+    if (book.find(state, book_move)) {
+        searcher.skip_search();
+        return book_move.to_move();
+    }
+
+    Node best_child = searcher.iterative_search(state);
+    searcher.start_pondering(state, best_child);
     return best_child.parent_move.to_move();
 }
 
@@ -58,31 +98,4 @@ GameMove* Moderator::getMove(GameState& state, const std::string& last_move) {
     return new DomineeringMove(m);
 }
 
-/* Private methods */
-
-unsigned Moderator::get_search_depth(const DomineeringState& state) const {
-    unsigned game_moves = state.getNumMoves();
-    unsigned depth;
-
-    if (searcher.get_time_left() > TIME_LIMIT) {
-        // The first four moves are not worth searching deep
-        if (game_moves <= 4) {
-            depth = 4;
-        }
-        else if (game_moves >= 16) {
-            depth = 11;
-        }
-        else if (game_moves >= 14) {
-            depth = 8;
-        }
-        else {
-            depth = 6;
-        }
-    }
-    else {
-        depth = 4;
-    }
-    return depth;
-}
-
 /* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -1,6 +1,7 @@
 #ifndef MODERATOR_H_
 #define MODERATOR_H_
 
+#include "OpeningBook.h"
 #include "Searcher.h"
 #include "TranspositionTable.h"
 
@@ -17,7 +18,6 @@
  */
 
 static const std::string GAME_NAME = "Domineering";
-static constexpr float TIME_LIMIT = 20;
 
 class Moderator : public GamePlayer {
 public:
@@ -44,17 +44,43 @@ public:
     Moderator& operator=(const Moderator& other);
 
     /**
-     * Reads in the file that contains the transposition table.
+     * Reads in the file that contains the transposition table, and maps the
+     * tablebase of region values and the opening book.
      */
     void init() override;
 
     /**
-     * Does housekeeping stuff like joining threads.
+     * Does housekeeping stuff like joining threads, and saves the
+     * transposition table for the next run.
      */
     void done() override;
 
     /**
-     * Uses the searcher to get the next move.
+     * Resets the clock to GAMETIME and MOVETIME from the tournament
+     * parameters.
+     *
+     * \param[in] opponent_name the name of the opponent.
+     */
+    void startGame(std::string opponent_name) override;
+
+    /**
+     * Tells the searcher how long the server says our last move took.
+     *
+     * \param[in] secs the time of our last move.
+     */
+    void timeOfLastMove(double secs) override;
+
+    /**
+     * Stops pondering; the position it was about will not come up.
+     *
+     * \param[in] result -1 if we lost, 0 if draw, +1 if we won.
+     */
+    void endGame(int result) override;
+
+    /**
+     * Plays the move from the opening book if there is one. Otherwise uses
+     * the searcher to get the next move, then has it ponder on the
+     * opponent's time.
      *
      * \param[in] last_move the last move made by the opponent.
      *
@@ -71,17 +97,9 @@ public:
     std::string messageForOpponent(const std::string& opponent_name) override;
 
 private:
-    /**
-     * Determines the depth to search down to.
-     *
-     * \param[in] state the current state of the game.
-     *
-     * \return the maximum depth to search.
-     */
-    unsigned get_search_depth(const DomineeringState& state) const;
-
     std::string team_name;
     Searcher searcher;
+    OpeningBook book;
     DomineeringMove next_game_move;
 };
 
@@ -0,0 +1,140 @@
+#ifndef MOVE_H_
+#define MOVE_H_
+
+#include "GameState.h"
+#include "Location.h"
+
+#include <cstdint>
+
+/**
+ * A move packed into 16 bits, for the search: the anchor cell of the domino
+ * (its left or top cell) in the low byte, and its orientation in the high
+ * byte, 1 if it lies vertically (AWAY's move). Any board up to 16x16 fits.
+ *
+ * The bottom right cell never anchors a domino, so cell 0xff stands for "no
+ * move".
+ */
+struct Move {
+    static const std::uint16_t NONE = 0x00ff;
+
+    Move()
+        : bits{NONE}
+    { }
+
+    /**
+     * \param[in] cell the anchor cell.
+     *
+     * \param[in] team the team making the move, which decides its
+     *                 orientation.
+     */
+    Move(const unsigned cell, const Who team)
+        : bits{static_cast<std::uint16_t>(
+                (cell & 0xff) | (team == Who::AWAY ? 0x100 : 0))}
+    { }
+
+    /**
+     * \return the move with the given packed bits.
+     */
+    static Move from_bits(const std::uint16_t bits);
+
+    unsigned cell() const {
+        return bits & 0xff;
+    }
+
+    bool vertical() const {
+        return (bits >> 8) != 0;
+    }
+
+    /**
+     * \return the team that makes the move.
+     */
+    Who team() const {
+        return vertical() ? Who::AWAY : Who::HOME;
+    }
+
+    bool is_none() const {
+        return cell() == 0xff;
+    }
+
+    /**
+     * \param[in] cols the columns of the board.
+     *
+     * \return the two cells of the domino.
+     */
+    Location to_location(const unsigned cols) const;
+
+    /**
+     * \param[in] location the two cells of a domino, the anchor first.
+     *
+     * \param[in] cols the columns of the board.
+     *
+     * \return the move that places it.
+     */
+    static Move from_location(const Location& location, const unsigned cols);
+
+    /**
+     * \param[in] symmetry a symmetry of the board, as in
+     *                     DomineeringState::getSymmetricKey: bit 0 mirrors
+     *                     left to right, bit 1 top to bottom.
+     *
+     * \param[in] rows the rows of the board.
+     *
+     * \param[in] cols the columns of the board.
+     *
+     * \return the move on the transformed board. Every symmetry is its own
+     *         inverse, so this also maps it back.
+     */
+    Move transform(const unsigned symmetry,
+                   const unsigned rows,
+                   const unsigned cols) const;
+
+    bool operator==(const Move& other) const {
+        return bits == other.bits;
+    }
+
+    bool operator!=(const Move& other) const {
+        return bits != other.bits;
+    }
+
+    std::uint16_t bits;
+};
+
+inline Move Move::from_bits(const std::uint16_t bits) {
+    Move move;
+    move.bits = bits;
+    return move;
+}
+
+inline Location Move::to_location(const unsigned cols) const {
+    const unsigned other = cell() + (vertical() ? cols : 1);
+    return Location(cell() / cols, cell() % cols, other / cols, other % cols);
+}
+
+inline Move Move::from_location(const Location& location,
+        const unsigned cols) {
+    return Move(location.r1 * cols + location.c1,
+            location.r1 == location.r2 ? Who::HOME : Who::AWAY);
+}
+
+inline Move Move::transform(const unsigned symmetry,
+        const unsigned rows,
+        const unsigned cols) const {
+    if (symmetry == 0 || is_none()) {
+        return *this;
+    }
+    unsigned r = cell() / cols;
+    unsigned c = cell() % cols;
+    // The anchor is the left or top cell, so the domino's length along the
+    // mirrored axis moves it by one more
+    if (symmetry & 1) {
+        c = cols - 1 - c - (vertical() ? 0 : 1);
+    }
+    if (symmetry & 2) {
+        r = rows - 1 - r - (vertical() ? 1 : 0);
+    }
+    return Move(r * cols + c, team());
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
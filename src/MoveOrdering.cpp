@@ -0,0 +1,91 @@
+#include "MoveOrdering.h"
+#include "DomineeringState.h"
+
+#include <algorithm>
+
+const unsigned MoveOrdering::KILLERS;
+const unsigned MoveOrdering::NO_MOVE;
+const std::uint32_t MoveOrdering::HISTORY_LIMIT;
+
+MoveOrdering::MoveOrdering()
+    : MoveOrdering(0, 0)
+{
+}
+
+MoveOrdering::MoveOrdering(const unsigned rows, const unsigned cols)
+    : cells{rows * cols}
+    , killers(DomineeringState::maxPlies(rows, cols) * KILLERS, NO_MOVE)
+    , history(2 * cells, 0)
+{
+}
+
+unsigned MoveOrdering::order(Bitboard moves,
+        const Who team,
+        const unsigned ply,
+        const Move first,
+        const Move after_killers,
+        MoveStack::move_t* ordered) const {
+    unsigned count = 0;
+
+    // The expected best move, then the killers, as long as they are legal
+    // here
+    if (!first.is_none() && first.team() == team
+            && moves.test(first.cell())) {
+        ordered[count++] = first;
+        moves.reset(first.cell());
+    }
+    if ((ply + 1) * KILLERS <= killers.size()) {
+        for (unsigned k = 0; k < KILLERS; k++) {
+            const unsigned killer = killers[ply * KILLERS + k];
+            if (killer != NO_MOVE && moves.test(killer)) {
+                ordered[count++] = Move(killer, team);
+                moves.reset(killer);
+            }
+        }
+    }
+    if (!after_killers.is_none() && after_killers.team() == team
+            && moves.test(after_killers.cell())) {
+        ordered[count++] = after_killers;
+        moves.reset(after_killers.cell());
+    }
+
+    // The rest by history. Insertion sort: there are only a few dozen, and
+    // it keeps the board order among equals.
+    const unsigned sorted = count;
+    while (moves.any()) {
+        const unsigned cell = moves.pop_lowest();
+        const std::uint32_t score = history_of(team, cell);
+        unsigned i = count++;
+        while (i > sorted
+                && history_of(team, ordered[i - 1].cell()) < score) {
+            ordered[i] = ordered[i - 1];
+            i--;
+        }
+        ordered[i] = Move(cell, team);
+    }
+    return count;
+}
+
+void MoveOrdering::cutoff(const unsigned ply,
+        const Move move,
+        const unsigned depth) {
+    const unsigned cell = move.cell();
+    if ((ply + 1) * KILLERS <= killers.size()) {
+        unsigned* slot = &killers[ply * KILLERS];
+        if (slot[0] != cell) {
+            // Most recent first; the oldest one drops out
+            std::copy_backward(slot, slot + KILLERS - 1, slot + KILLERS);
+            slot[0] = cell;
+        }
+    }
+
+    std::uint32_t& score = history[(move.vertical() ? cells : 0) + cell];
+    score += depth * depth;
+    if (score >= HISTORY_LIMIT) {
+        for (std::uint32_t& h : history) {
+            h /= 2;
+        }
+    }
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
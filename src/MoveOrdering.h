@@ -0,0 +1,124 @@
+#ifndef MOVE_ORDERING_H_
+#define MOVE_ORDERING_H_
+
+#include "Bitboard.h"
+#include "GameState.h"
+#include "MoveStack.h"
+
+#include <cstdint>
+#include <vector>
+
+/**
+ * Decides in which order the moves of a node are searched, so that the move
+ * most likely to cause a cutoff comes first. Every search thread has its
+ * own, so nothing here is shared. A new one is made for every search: the
+ * killers and the history last from one iteration to the next, and are
+ * gone once the search is over.
+ *
+ * The order is:
+ *
+ *   1. the move the caller already expects to be best (the best move of the
+ *      previous iteration at the root, the move stored with an exact score
+ *      in the transposition table elsewhere),
+ *   2. the killer moves of the ply: the last moves that caused a cutoff at
+ *      the same depth, in a sibling subtree,
+ *   3. a move the caller expects to be good, but less sure of than the
+ *      killers (a move that caused a cutoff here in an earlier iteration),
+ *   4. every other move, by its history score: how much cutoffs it caused
+ *      anywhere in the tree so far, weighted by the depth under them.
+ *      Ties keep the board order.
+ *
+ * All memory is taken when the object is made; ordering and recording
+ * cutoffs never allocate.
+ */
+class MoveOrdering {
+public:
+    /**
+     * Number of killer moves kept per ply.
+     */
+    static const unsigned KILLERS = 2;
+
+    /**
+     * Stands for "no killer".
+     */
+    static const unsigned NO_MOVE = Bitboard::MAX_CELLS;
+
+    /**
+     * History scores are halved once one of them reaches this, so that old
+     * cutoffs fade and nothing overflows.
+     */
+    static const std::uint32_t HISTORY_LIMIT = 1u << 24;
+
+    MoveOrdering();
+
+    /**
+     * \param[in] rows the rows of the board.
+     *
+     * \param[in] cols the columns of the board.
+     */
+    MoveOrdering(const unsigned rows, const unsigned cols);
+
+    /**
+     * Puts the moves in the order they should be searched in.
+     *
+     * \param[in] moves anchor cells of the moves.
+     *
+     * \param[in] team the team making the moves.
+     *
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \param[in] first the move to search before all others, if any.
+     *
+     * \param[in] after_killers the move to search right after the killers,
+     *                          if any.
+     *
+     * \param[out] ordered the moves in order. Must have room for
+     *                     moves.count() moves.
+     *
+     * \return the number of moves, moves.count().
+     */
+    unsigned order(Bitboard moves,
+                   const Who team,
+                   const unsigned ply,
+                   const Move first,
+                   const Move after_killers,
+                   MoveStack::move_t* ordered) const;
+
+    /**
+     * Remembers a move that caused a cutoff.
+     *
+     * \param[in] ply the depth of the node the move was made from.
+     *
+     * \param[in] move the move.
+     *
+     * \param[in] depth the number of plies that were searched under the
+     *                  node.
+     */
+    void cutoff(const unsigned ply,
+                const Move move,
+                const unsigned depth);
+
+private:
+    /* Number of cells on the board */
+    unsigned cells;
+
+    /* KILLERS cells per ply, most recent first; NO_MOVE if unused */
+    std::vector<unsigned> killers;
+
+    /* One score per team and cell: HOME's cells, then AWAY's */
+    std::vector<std::uint32_t> history;
+
+    /**
+     * \return the history score of a move.
+     */
+    std::uint32_t history_of(const Who team, const unsigned cell) const;
+};
+
+inline std::uint32_t MoveOrdering::history_of(const Who team,
+        const unsigned cell) const {
+    return history[(team == Who::HOME ? 0 : cells) + cell];
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,59 @@
+#ifndef MOVE_STACK_H_
+#define MOVE_STACK_H_
+
+#include "DomineeringState.h"
+#include "Move.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+/**
+ * The moves of every node on the path a search thread is on, in a single
+ * buffer that is taken when the thread is set up. The node at ply p writes
+ * its moves into frame p; the frame stays put while the node's subtree is
+ * searched, since that only uses the frames after it. Nothing is allocated
+ * during the search.
+ *
+ * Moves are packed (see Move), so a frame of an 8x8 board takes 112 bytes.
+ */
+class MoveStack {
+public:
+    using move_t = Move;
+
+    MoveStack()
+        : MoveStack(0, 0)
+    { }
+
+    /**
+     * \param[in] rows the rows of the board.
+     *
+     * \param[in] cols the columns of the board.
+     */
+    MoveStack(const unsigned rows, const unsigned cols)
+        // A position has at most one move per anchor: cells that have a
+        // neighbour to the right, or below
+        : width{std::max(rows * (cols > 0 ? cols - 1 : 0),
+                         (rows > 0 ? rows - 1 : 0) * cols)}
+        , moves(DomineeringState::maxPlies(rows, cols) * width)
+    { }
+
+    /**
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \return room for the moves of a node at that ply.
+     */
+    move_t* frame(const unsigned ply) {
+        return &moves[ply * width];
+    }
+
+private:
+    /* Room per ply */
+    unsigned width;
+
+    std::vector<move_t> moves;
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -5,10 +5,6 @@ Node::Node()
     : score_{0}
     , is_unset{true}
     , is_terminal_{true}
-    // I searched myself
-    , descentdants_searched{1}
-    , lower_limit{AlphaBeta::NEG_INF}
-    , upper_limit{AlphaBeta::POS_INF}
 {
 }
 
@@ -18,10 +14,6 @@ Node::Node(Who team, unsigned depth)
     , score_{0}
     , is_unset{true}
     , is_terminal_{false}
-    // I searched myself
-    , descentdants_searched{1}
-    , lower_limit{AlphaBeta::NEG_INF}
-    , upper_limit{AlphaBeta::POS_INF}
 {
 }
 
@@ -32,10 +24,6 @@ Node::Node(Who team, unsigned depth, Location parent_move)
     , parent_move{parent_move}
     , is_unset{true}
     , is_terminal_{false}
-    // I searched myself
-    , descentdants_searched{1}
-    , lower_limit{AlphaBeta::NEG_INF}
-    , upper_limit{AlphaBeta::POS_INF}
 {
 }
 
@@ -46,9 +34,6 @@ Node::Node(const Node& other)
     , parent_move{other.parent_move}
     , is_unset{other.is_unset}
     , is_terminal_{other.is_terminal_}
-    , descentdants_searched{other.descentdants_searched}
-    , lower_limit{other.lower_limit}
-    , upper_limit{other.upper_limit}
 {
 }
 
@@ -59,9 +44,6 @@ Node::Node(Node&& other)
     , parent_move{std::move(other.parent_move)}
     , is_unset{other.is_unset}
     , is_terminal_{other.is_terminal_}
-    , descentdants_searched{other.descentdants_searched}
-    , lower_limit{other.lower_limit}
-    , upper_limit{other.upper_limit}
 {
 }
 
@@ -75,9 +57,6 @@ Node& Node::operator=(const Node& other) {
     parent_move = other.parent_move;
     is_unset = other.is_unset;
     is_terminal_ = other.is_terminal_;
-    descentdants_searched = other.descentdants_searched;
-    lower_limit = other.lower_limit;
-    upper_limit = other.upper_limit;
     return *this;
 }
 /* }}} */
@@ -0,0 +1,99 @@
+#include "OpeningBook.h"
+#include "Move.h"
+#include "Params.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+const std::uint32_t OpeningBook::VERSION;
+const unsigned OpeningBook::SYMMETRIES;
+const char OpeningBook::MAGIC[8] = {'U', 'C', 'C', 'B', 'O', 'O', 'K', '\0'};
+
+OpeningBook::OpeningBook()
+    : header{nullptr}
+    , entries{nullptr}
+{
+}
+
+std::string OpeningBook::default_path() {
+    return std::string("config") + Params::separatorChar + "book.bin";
+}
+
+bool OpeningBook::open(const std::string& path) {
+    close();
+    if (!file.open(path) || file.size() < sizeof(Header)) {
+        close();
+        return false;
+    }
+
+    const Header* h = static_cast<const Header*>(file.data());
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0
+            || h->version != VERSION
+            || file.size() != sizeof(Header) + sizeof(Entry) * h->entries) {
+        close();
+        return false;
+    }
+
+    header = h;
+    entries = reinterpret_cast<const Entry*>(
+            static_cast<const char*>(file.data()) + sizeof(Header));
+    return true;
+}
+
+void OpeningBook::close() {
+    file.close();
+    header = nullptr;
+    entries = nullptr;
+}
+
+bool OpeningBook::find(const DomineeringState& state, Location& move) const {
+    if (header == nullptr
+            || header->rows != static_cast<unsigned>(state.ROWS)
+            || header->cols != static_cast<unsigned>(state.COLS)) {
+        return false;
+    }
+
+    unsigned symmetry;
+    const key_t key = state.getCanonicalKey(symmetry);
+    const Entry* end = entries + header->entries;
+    const Entry* found = std::lower_bound(entries, end, key,
+            [](const Entry& e, const key_t key) {
+                return e.key < key;
+            });
+    if (found == end || found->key != key) {
+        return false;
+    }
+
+    const Move stored = Move::from_location(
+            Location(found->r1, found->c1, found->r2, found->c2), state.COLS);
+    move = stored.transform(symmetry, state.ROWS, state.COLS)
+        .to_location(state.COLS);
+    // Keys can collide, if very rarely
+    return state.moveOK(move.to_move());
+}
+
+bool OpeningBook::write(const std::string& path,
+        const unsigned rows,
+        const unsigned cols,
+        std::vector<Entry> entries) {
+    std::sort(entries.begin(), entries.end(),
+            [](const Entry& a, const Entry& b) {
+                return a.key < b.key;
+            });
+
+    Header h;
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.rows = rows;
+    h.cols = cols;
+    h.entries = entries.size();
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    ofs.write(reinterpret_cast<const char*>(entries.data()),
+            sizeof(Entry) * entries.size());
+    return static_cast<bool>(ofs);
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,134 @@
+#ifndef OPENING_BOOK_H_
+#define OPENING_BOOK_H_
+
+#include "DomineeringState.h"
+#include "Location.h"
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Moves for the first few plies of the game, found offline by deep searches
+ * (tools/book) and memory-mapped at startup.
+ *
+ * Positions are stored under their canonical key (see
+ * DomineeringState::getCanonicalKey): the smallest Zobrist key of the board
+ * under the symmetries that keep horizontal dominoes horizontal (mirroring
+ * left to right, top to bottom, or both). The move is stored as it is on
+ * the canonical board and mapped back on lookup (see Move::transform), so
+ * one entry serves all four boards.
+ *
+ * Layout, in native byte order: a header, then the entries sorted by key.
+ */
+class OpeningBook {
+public:
+    using key_t = std::uint64_t;
+
+    /**
+     * Changes whenever the layout of the file does.
+     */
+    static const std::uint32_t VERSION = 1;
+
+    /**
+     * Number of symmetries: identity, mirror left to right, mirror top to
+     * bottom, and both (a half turn). Each is its own inverse.
+     */
+    static const unsigned SYMMETRIES = DomineeringState::SYMMETRIES;
+
+    struct Entry {
+        key_t key;
+        /* The move on the canonical board */
+        std::uint8_t r1, c1, r2, c2;
+        /* Depth of the search that found the move */
+        std::uint16_t depth;
+        std::uint16_t padding;
+    };
+
+    OpeningBook();
+
+    OpeningBook(const OpeningBook&) = delete;
+    OpeningBook& operator=(const OpeningBook&) = delete;
+
+    /**
+     * \return where the book is looked for: config/book.bin.
+     */
+    static std::string default_path();
+
+    /**
+     * Maps the book into memory. A book that was open before is closed
+     * first.
+     *
+     * \param[in] path the file made by tools/book.
+     *
+     * \return false if the file is missing or is not a valid book.
+     */
+    bool open(const std::string& path);
+
+    void close();
+
+    bool is_open() const;
+
+    /**
+     * \return the number of positions in the book.
+     */
+    std::size_t size() const;
+
+    /**
+     * Looks up the move to play.
+     *
+     * \param[in] state the current position.
+     *
+     * \param[out] move the move from the book, if there is one.
+     *
+     * \return true if the position is in the book and its move is legal.
+     */
+    bool find(const DomineeringState& state, Location& move) const;
+
+    /**
+     * Writes a book.
+     *
+     * \param[in] path the file to write.
+     *
+     * \param[in] rows the rows of the board the book is for.
+     *
+     * \param[in] cols the columns of the board the book is for.
+     *
+     * \param[in] entries the positions, in any order.
+     *
+     * \return false if the file could not be written.
+     */
+    static bool write(const std::string& path,
+                      const unsigned rows,
+                      const unsigned cols,
+                      std::vector<Entry> entries);
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t rows;
+        std::uint32_t cols;
+        std::uint32_t entries;
+    };
+
+    static const char MAGIC[8];
+
+    MappedFile file;
+    const Header* header;
+    const Entry* entries;
+};
+
+inline bool OpeningBook::is_open() const {
+    return header != nullptr;
+}
+
+inline std::size_t OpeningBook::size() const {
+    return header == nullptr ? 0 : header->entries;
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,125 @@
+#ifndef PRINCIPAL_VARIATION_H_
+#define PRINCIPAL_VARIATION_H_
+
+#include "DomineeringState.h"
+#include "Move.h"
+
+#include <algorithm>
+#include <vector>
+
+/**
+ * The principal variation of every node on the path a search thread is on,
+ * in a triangular table: the line of the node at ply p is row p, which
+ * starts with the node's best move at column p and goes on with the line of
+ * the child it leads to. Whenever a node finds a new best move, the child's
+ * row is copied into its own, so the root's row always holds the line the
+ * search expects to be played.
+ *
+ * All memory is taken when the object is made; nothing is allocated while
+ * searching.
+ */
+class PrincipalVariation {
+public:
+    PrincipalVariation()
+        : PrincipalVariation(0, 0)
+    { }
+
+    /**
+     * \param[in] rows the rows of the board.
+     *
+     * \param[in] cols the columns of the board.
+     */
+    PrincipalVariation(const unsigned rows, const unsigned cols)
+        : plies{DomineeringState::maxPlies(rows, cols)}
+        , moves(plies * plies)
+        , ends(plies, 0)
+    { }
+
+    /**
+     * Empties the line of a node: it has no best move (yet).
+     *
+     * \param[in] ply the depth of the node in the tree.
+     */
+    void clear(const unsigned ply) {
+        ends[ply] = ply;
+    }
+
+    /**
+     * Makes `move' the best move of the node, followed by the line of the
+     * child it leads to.
+     *
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \param[in] move the new best move.
+     */
+    void update(const unsigned ply, const Move move) {
+        Move* row = &moves[ply * plies];
+        row[ply] = move;
+        const unsigned end = std::max(ply + 1, ends[ply + 1]);
+        std::copy(&moves[(ply + 1) * plies + ply + 1],
+                  &moves[(ply + 1) * plies + end],
+                  row + ply + 1);
+        ends[ply] = end;
+    }
+
+    /**
+     * Same as above, with the child's line given. Used when another thread
+     * searched the child.
+     *
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \param[in] move the new best move.
+     *
+     * \param[in] rest the line of the child.
+     */
+    void update(const unsigned ply,
+                const Move move,
+                const std::vector<Move>& rest) {
+        Move* row = &moves[ply * plies];
+        row[ply] = move;
+        const unsigned length =
+            std::min<unsigned>(rest.size(), plies - ply - 1);
+        std::copy(rest.begin(), rest.begin() + length, row + ply + 1);
+        ends[ply] = ply + 1 + length;
+    }
+
+    /**
+     * Replaces the line of a node.
+     *
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \param[in] line the new line, best move first.
+     */
+    void assign(const unsigned ply, const std::vector<Move>& line) {
+        if (line.empty()) {
+            clear(ply);
+            return;
+        }
+        update(ply, line.front(),
+               std::vector<Move>(line.begin() + 1, line.end()));
+    }
+
+    /**
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \return the line of the node, best move first.
+     */
+    std::vector<Move> line(const unsigned ply) const {
+        return std::vector<Move>(&moves[ply * plies + ply],
+                                 &moves[ply * plies + ends[ply]]);
+    }
+
+private:
+    /* Rows and columns of the table */
+    unsigned plies;
+
+    /* Row p holds the line of the node at ply p from column p on */
+    std::vector<Move> moves;
+
+    /* One past the last move of each row */
+    std::vector<unsigned> ends;
+};
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,752 @@
+#include "RegionSolver.h"
+
+#include <algorithm>
+#include <utility>
+
+const RegionSolver::value_t RegionSolver::ZERO;
+const unsigned RegionSolver::MAX_REGION_CELLS;
+const unsigned RegionSolver::MAX_SIDE;
+const std::size_t RegionSolver::MAX_FORMS;
+const RegionSolver::value_t RegionSolver::NONE;
+
+/* Constructors {{{ */
+RegionSolver::Shape::Shape()
+    : rows{0}
+    , cols{0}
+    , row{}
+{
+}
+
+RegionSolver::Decomposition::Decomposition()
+    : solved{true}
+    , value{ZERO}
+{
+}
+
+RegionSolver::RegionSolver(const unsigned rows, const unsigned cols)
+    : board_rows{rows}
+    , board_cols{cols}
+    , tablebase{nullptr}
+    , transposes{true}
+{
+    for (unsigned cell = 0; cell < rows * cols; cell++) {
+        if (cell % cols != 0) {
+            not_first_column.set(cell);
+        }
+        if (cell % cols != cols - 1) {
+            not_last_column.set(cell);
+        }
+    }
+    clear();
+}
+/* }}} */
+
+/* Shapes {{{ */
+unsigned RegionSolver::Shape::size() const {
+    unsigned n = 0;
+    for (unsigned r = 0; r < rows; r++) {
+        n += __builtin_popcount(row[r]);
+    }
+    return n;
+}
+
+std::string RegionSolver::Shape::key() const {
+    std::string k(2 + 2 * rows, '\0');
+    k[0] = static_cast<char>(rows);
+    k[1] = static_cast<char>(cols);
+    for (unsigned r = 0; r < rows; r++) {
+        k[2 + 2 * r] = static_cast<char>(row[r] & 0xff);
+        k[3 + 2 * r] = static_cast<char>(row[r] >> 8);
+    }
+    return k;
+}
+
+RegionSolver::Shape RegionSolver::Shape::flip_horizontal() const {
+    Shape flipped{*this};
+    for (unsigned r = 0; r < rows; r++) {
+        std::uint16_t mirrored = 0;
+        for (unsigned c = 0; c < cols; c++) {
+            if (row[r] >> c & 1) {
+                mirrored |= 1 << (cols - 1 - c);
+            }
+        }
+        flipped.row[r] = mirrored;
+    }
+    return flipped;
+}
+
+RegionSolver::Shape RegionSolver::Shape::flip_vertical() const {
+    Shape flipped{*this};
+    std::reverse(flipped.row, flipped.row + rows);
+    return flipped;
+}
+
+RegionSolver::Shape RegionSolver::Shape::transposed() const {
+    Shape t;
+    t.rows = cols;
+    t.cols = rows;
+    for (unsigned r = 0; r < rows; r++) {
+        for (unsigned c = 0; c < cols; c++) {
+            if (row[r] >> c & 1) {
+                t.row[c] |= 1 << r;
+            }
+        }
+    }
+    return t;
+}
+
+RegionSolver::Shape RegionSolver::Shape::normalized() const {
+    // Horizontal dominoes stay horizontal in a mirror image, so the value
+    // does not change. Rotations by 90 degrees would swap the players.
+    const Shape h = flip_horizontal();
+    const Shape candidates[] = {*this, h, flip_vertical(), h.flip_vertical()};
+
+    const Shape* best = &candidates[0];
+    std::string best_key = best->key();
+    for (const Shape& candidate : candidates) {
+        std::string k = candidate.key();
+        if (k < best_key) {
+            best = &candidate;
+            best_key = std::move(k);
+        }
+    }
+    return *best;
+}
+
+RegionSolver::Shape RegionSolver::Shape::canonical(bool& transposed) const {
+    // Transposing swaps the players, which negates the value
+    const Shape s = normalized();
+    const Shape t = this->transposed().normalized();
+    transposed = t.key() < s.key();
+    return transposed ? t : s;
+}
+
+RegionSolver::Shape RegionSolver::Shape::trimmed() const {
+    unsigned first = 0;
+    while (first < rows && row[first] == 0) {
+        first++;
+    }
+    unsigned last = rows;
+    while (last > first && row[last - 1] == 0) {
+        last--;
+    }
+
+    std::uint16_t used = 0;
+    for (unsigned r = first; r < last; r++) {
+        used |= row[r];
+    }
+
+    Shape t;
+    if (used == 0) {
+        return t;
+    }
+    const unsigned shift = __builtin_ctz(used);
+    const unsigned highest = 31 - __builtin_clz(used);
+    t.rows = last - first;
+    t.cols = highest - shift + 1;
+    for (unsigned r = first; r < last; r++) {
+        t.row[r - first] = row[r] >> shift;
+    }
+    return t;
+}
+
+std::vector<RegionSolver::Shape> RegionSolver::regions(const Shape& shape) {
+    std::vector<Shape> found;
+    Shape remaining{shape};
+
+    for (unsigned start = 0; start < remaining.rows; ) {
+        if (remaining.row[start] == 0) {
+            start++;
+            continue;
+        }
+
+        // Flood fill from the lowest cell of the first row that is left
+        Shape region;
+        region.rows = remaining.rows;
+        region.cols = remaining.cols;
+        region.row[start] = remaining.row[start] & -remaining.row[start];
+
+        bool grew = true;
+        while (grew) {
+            grew = false;
+            for (unsigned r = 0; r < remaining.rows; r++) {
+                std::uint16_t g = region.row[r]
+                    | region.row[r] << 1
+                    | region.row[r] >> 1;
+                if (r > 0) {
+                    g |= region.row[r - 1];
+                }
+                if (r + 1 < remaining.rows) {
+                    g |= region.row[r + 1];
+                }
+                g &= remaining.row[r];
+                if (g != region.row[r]) {
+                    region.row[r] = g;
+                    grew = true;
+                }
+            }
+        }
+
+        for (unsigned r = 0; r < remaining.rows; r++) {
+            remaining.row[r] &= ~region.row[r];
+        }
+        found.push_back(region.trimmed());
+    }
+    return found;
+}
+/* }}} */
+
+void RegionSolver::clear() {
+    forms.clear();
+    form_index.clear();
+    comparisons.clear();
+    sums.clear();
+    shapes.clear();
+    placed.clear();
+    imported.clear();
+    negatives.clear();
+
+    // ZERO is always the first form
+    intern({}, {});
+}
+
+RegionSolver::Decomposition RegionSolver::decompose(const Bitboard& empty) {
+    if (forms.size() > MAX_FORMS || placed.size() > MAX_FORMS) {
+        clear();
+    }
+
+    Decomposition parts;
+    std::vector<std::pair<value_t, Bitboard>> solved;
+
+    Bitboard remaining{empty};
+    while (remaining.any()) {
+        const Bitboard region = region_of(remaining, remaining.lowest());
+        remaining &= ~region;
+
+        value_t v = ZERO;
+        auto found = placed.find(region);
+        if (found != placed.end()) {
+            v = found->second;
+        }
+        // A single cell is no use to anybody
+        else if (region.count() > 1) {
+            bool fits;
+            const Shape shape = to_shape(region, fits);
+            if (!fits) {
+                parts.solved = false;
+                continue;
+            }
+            v = value(shape);
+            placed.emplace(region, v);
+        }
+
+        if (v == ZERO) {
+            parts.resolved |= region;
+            continue;
+        }
+        solved.push_back(std::make_pair(v, region));
+    }
+
+    // A region and its negative add up to 0, so both can be left out. This
+    // also makes the sum below smaller.
+    std::vector<bool> cancelled(solved.size(), false);
+    for (std::size_t i = 0; i < solved.size(); i++) {
+        const value_t minus = negate(solved[i].first);
+        for (std::size_t j = i + 1; j < solved.size() && !cancelled[i]; j++) {
+            if (!cancelled[j] && solved[j].first == minus) {
+                cancelled[i] = cancelled[j] = true;
+                parts.resolved |= solved[i].second;
+                parts.resolved |= solved[j].second;
+            }
+        }
+    }
+
+    // Adding up is only worth it if it gives the value of the whole board.
+    // Always in the same order, so that partial sums come from the cache.
+    if (parts.solved) {
+        std::vector<value_t> values;
+        for (std::size_t i = 0; i < solved.size(); i++) {
+            if (!cancelled[i]) {
+                values.push_back(solved[i].first);
+            }
+        }
+        std::sort(values.begin(), values.end());
+        for (value_t v : values) {
+            parts.value = add(parts.value, v);
+        }
+    }
+    return parts;
+}
+
+RegionSolver::value_t RegionSolver::negate(const value_t g) {
+    if (g < negatives.size() && negatives[g] != NONE) {
+        return negatives[g];
+    }
+
+    // Copies: negating may grow the table under us
+    const Form form = forms[g];
+    std::vector<value_t> left, right;
+    for (value_t r : form.right) {
+        left.push_back(negate(r));
+    }
+    for (value_t l : form.left) {
+        right.push_back(negate(l));
+    }
+    // The negative of a canonical form is canonical
+    std::sort(left.begin(), left.end());
+    std::sort(right.begin(), right.end());
+    const value_t minus = intern(left, right);
+
+    if (negatives.size() < forms.size()) {
+        negatives.resize(forms.size(), NONE);
+    }
+    negatives[g] = minus;
+    negatives[minus] = g;
+    return minus;
+}
+
+RegionSolver::value_t RegionSolver::value(const Shape& shape) {
+    // A single cell is no use to anybody
+    if (shape.size() <= 1) {
+        return ZERO;
+    }
+    if (!transposes) {
+        return solve(shape.trimmed().normalized());
+    }
+    bool transposed;
+    const value_t v = solve(shape.trimmed().canonical(transposed));
+    return transposed ? negate(v) : v;
+}
+
+RegionSolver::value_t RegionSolver::solve(const Shape& s) {
+    const std::string k = s.key();
+    auto found = shapes.find(k);
+    if (found != shapes.end()) {
+        return found->second;
+    }
+
+    if (tablebase != nullptr) {
+        const Tablebase::form_t form = tablebase->find(k);
+        if (form != Tablebase::NOT_FOUND) {
+            const value_t v = import(form);
+            shapes[k] = v;
+            return v;
+        }
+    }
+
+    std::vector<value_t> left, right;
+    for (unsigned r = 0; r < s.rows; r++) {
+        for (unsigned c = 0; c < s.cols; c++) {
+            const std::uint16_t bit = 1 << c;
+            if (!(s.row[r] & bit)) {
+                continue;
+            }
+            // Horizontal domino anchored here
+            if (s.row[r] & bit << 1) {
+                Shape option{s};
+                option.row[r] &= ~(bit | bit << 1);
+                left.push_back(sum_of_regions(option));
+            }
+            // Vertical domino anchored here
+            if (r + 1 < s.rows && (s.row[r + 1] & bit)) {
+                Shape option{s};
+                option.row[r] &= ~bit;
+                option.row[r + 1] &= ~bit;
+                right.push_back(sum_of_regions(option));
+            }
+        }
+    }
+
+    const value_t v = canonical(std::move(left), std::move(right));
+    shapes[k] = v;
+    return v;
+}
+
+void RegionSolver::use_tablebase(const Tablebase* tablebase) {
+    this->tablebase = tablebase;
+    // Form numbers of the old one mean nothing for the new one
+    imported.clear();
+}
+
+bool RegionSolver::save(const std::string& path) const {
+    // Only the forms that are reachable from a shape are written. Options
+    // always come before the forms they belong to, so numbering them in
+    // order keeps it that way.
+    std::vector<bool> reachable(forms.size(), false);
+    std::vector<value_t> pending;
+    for (const auto& shape : shapes) {
+        pending.push_back(shape.second);
+    }
+    while (!pending.empty()) {
+        const value_t g = pending.back();
+        pending.pop_back();
+        if (reachable[g]) {
+            continue;
+        }
+        reachable[g] = true;
+        pending.insert(pending.end(),
+                forms[g].left.begin(), forms[g].left.end());
+        pending.insert(pending.end(),
+                forms[g].right.begin(), forms[g].right.end());
+    }
+
+    std::vector<Tablebase::form_t> renumbered(forms.size());
+    std::vector<Tablebase::Form> written;
+    for (value_t g = 0; g < forms.size(); g++) {
+        if (!reachable[g]) {
+            continue;
+        }
+        renumbered[g] = written.size();
+        Tablebase::Form form;
+        for (value_t l : forms[g].left) {
+            form.first.push_back(renumbered[l]);
+        }
+        for (value_t r : forms[g].right) {
+            form.second.push_back(renumbered[r]);
+        }
+        written.push_back(form);
+    }
+
+    std::vector<std::pair<std::string, Tablebase::form_t>> records;
+    for (const auto& shape : shapes) {
+        records.push_back(std::make_pair(shape.first,
+                    renumbered[shape.second]));
+    }
+    return Tablebase::write(path, written, records);
+}
+
+RegionSolver::value_t RegionSolver::import(const Tablebase::form_t form) {
+    auto found = imported.find(form);
+    if (found != imported.end()) {
+        return found->second;
+    }
+
+    std::vector<Tablebase::form_t> left_forms, right_forms;
+    tablebase->options(form, left_forms, right_forms);
+    std::vector<value_t> left, right;
+    for (Tablebase::form_t l : left_forms) {
+        left.push_back(import(l));
+    }
+    for (Tablebase::form_t r : right_forms) {
+        right.push_back(import(r));
+    }
+    // Canonical in the file, so canonical here: only the numbers differ
+    std::sort(left.begin(), left.end());
+    std::sort(right.begin(), right.end());
+    const value_t v = intern(left, right);
+    imported[form] = v;
+    return v;
+}
+
+RegionSolver::value_t RegionSolver::sum_of_regions(const Shape& shape) {
+    value_t total = ZERO;
+    for (const Shape& region : regions(shape)) {
+        total = add(total, value(region));
+    }
+    return total;
+}
+
+RegionSolver::value_t RegionSolver::add(value_t a, value_t b) {
+    if (a == ZERO) {
+        return b;
+    }
+    if (b == ZERO) {
+        return a;
+    }
+    if (a > b) {
+        std::swap(a, b);
+    }
+
+    const std::uint64_t k = std::uint64_t{a} << 32 | b;
+    auto found = sums.find(k);
+    if (found != sums.end()) {
+        return found->second;
+    }
+
+    // Copies: adding may grow the table under us
+    const Form fa = forms[a];
+    const Form fb = forms[b];
+    std::vector<value_t> left, right;
+    for (value_t l : fa.left) {
+        left.push_back(add(l, b));
+    }
+    for (value_t l : fb.left) {
+        left.push_back(add(a, l));
+    }
+    for (value_t r : fa.right) {
+        right.push_back(add(r, b));
+    }
+    for (value_t r : fb.right) {
+        right.push_back(add(a, r));
+    }
+
+    const value_t v = canonical(std::move(left), std::move(right));
+    sums[k] = v;
+    return v;
+}
+
+bool RegionSolver::less_equal(const value_t a, const value_t b) {
+    if (a == b) {
+        return true;
+    }
+
+    const std::uint64_t k = std::uint64_t{a} << 32 | b;
+    auto found = comparisons.find(k);
+    if (found != comparisons.end()) {
+        return found->second;
+    }
+
+    // a <= b unless some a^L >= b or some b^R <= a
+    bool result = true;
+    for (value_t l : forms[a].left) {
+        if (less_equal(b, l)) {
+            result = false;
+            break;
+        }
+    }
+    if (result) {
+        for (value_t r : forms[b].right) {
+            if (less_equal(r, a)) {
+                result = false;
+                break;
+            }
+        }
+    }
+
+    comparisons[k] = result;
+    return result;
+}
+
+bool RegionSolver::less_equal(const value_t x,
+        const std::vector<value_t>& left,
+        const std::vector<value_t>& right) {
+    for (value_t l : forms[x].left) {
+        if (less_equal(left, right, l)) {
+            return false;
+        }
+    }
+    for (value_t r : right) {
+        if (less_equal(r, x)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RegionSolver::less_equal(const std::vector<value_t>& left,
+        const std::vector<value_t>& right,
+        const value_t x) {
+    for (value_t l : left) {
+        if (less_equal(x, l)) {
+            return false;
+        }
+    }
+    for (value_t r : forms[x].right) {
+        if (less_equal(r, left, right)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+RegionSolver::value_t RegionSolver::canonical(std::vector<value_t> left,
+        std::vector<value_t> right) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+
+        std::sort(left.begin(), left.end());
+        left.erase(std::unique(left.begin(), left.end()), left.end());
+        std::sort(right.begin(), right.end());
+        right.erase(std::unique(right.begin(), right.end()), right.end());
+
+        // Dominated options: Left never needs a smaller option, Right never
+        // a larger one. Distinct values are never equal, so at most one of
+        // two options goes.
+        std::vector<value_t> kept;
+        for (value_t a : left) {
+            bool dominated = false;
+            for (value_t b : left) {
+                if (a != b && less_equal(a, b)) {
+                    dominated = true;
+                    break;
+                }
+            }
+            if (!dominated) {
+                kept.push_back(a);
+            }
+        }
+        left.swap(kept);
+        kept.clear();
+        for (value_t a : right) {
+            bool dominated = false;
+            for (value_t b : right) {
+                if (a != b && less_equal(b, a)) {
+                    dominated = true;
+                    break;
+                }
+            }
+            if (!dominated) {
+                kept.push_back(a);
+            }
+        }
+        right.swap(kept);
+
+        // Reversible options: a Left option A with a Right reply A^R <= G
+        // is replaced by the Left options of A^R, and the other way round.
+        for (std::size_t i = 0; i < left.size() && !changed; i++) {
+            for (value_t reply : forms[left[i]].right) {
+                if (less_equal(reply, left, right)) {
+                    const std::vector<value_t> bypass = forms[reply].left;
+                    left.erase(left.begin() + i);
+                    left.insert(left.end(), bypass.begin(), bypass.end());
+                    changed = true;
+                    break;
+                }
+            }
+        }
+        for (std::size_t i = 0; i < right.size() && !changed; i++) {
+            for (value_t reply : forms[right[i]].left) {
+                if (less_equal(left, right, reply)) {
+                    const std::vector<value_t> bypass = forms[reply].right;
+                    right.erase(right.begin() + i);
+                    right.insert(right.end(), bypass.begin(), bypass.end());
+                    changed = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    return intern(left, right);
+}
+
+RegionSolver::value_t RegionSolver::intern(const std::vector<value_t>& left,
+        const std::vector<value_t>& right) {
+    std::string k;
+    k.reserve(4 * (left.size() + right.size() + 1));
+    auto append = [&k](const value_t v) {
+        k.append(reinterpret_cast<const char*>(&v), sizeof(v));
+    };
+    append(left.size());
+    for (value_t v : left) {
+        append(v);
+    }
+    for (value_t v : right) {
+        append(v);
+    }
+
+    auto found = form_index.find(k);
+    if (found != form_index.end()) {
+        return found->second;
+    }
+
+    const value_t v = forms.size();
+    forms.push_back(Form{left, right});
+    form_index.emplace(std::move(k), v);
+    return v;
+}
+
+std::size_t RegionSolver::BitboardHash::operator()(const Bitboard& b) const {
+    std::uint64_t h = 0;
+    for (unsigned i = 0; i < Bitboard::words; i++) {
+        h = (h ^ b.w[i]) * 0x9e3779b97f4a7c15ULL;
+    }
+    return h ^ h >> 32;
+}
+
+Bitboard RegionSolver::region_of(const Bitboard& empty,
+        const unsigned cell) const {
+    Bitboard region;
+    region.set(cell);
+
+    // Boards up to 8x8 fit in a word, which is worth doing on its own: this
+    // runs at every node of the endgame
+    if (Bitboard::words == 1) {
+        const Bitboard::word_t open = empty.w[0];
+        const Bitboard::word_t right = not_first_column.w[0];
+        const Bitboard::word_t left = not_last_column.w[0];
+        Bitboard::word_t r = region.w[0];
+        while (true) {
+            const Bitboard::word_t grown = open & (r
+                    | ((r << 1) & right)
+                    | ((r >> 1) & left)
+                    | (r << board_cols)
+                    | (r >> board_cols));
+            if (grown == r) {
+                region.w[0] = r;
+                return region;
+            }
+            r = grown;
+        }
+    }
+
+    while (true) {
+        Bitboard grown = region
+            | ((region << 1) & not_first_column)
+            | ((region >> 1) & not_last_column)
+            | (region << board_cols)
+            | (region >> board_cols);
+        grown &= empty;
+        if (grown == region) {
+            return region;
+        }
+        region = grown;
+    }
+}
+
+RegionSolver::Shape RegionSolver::to_shape(const Bitboard& region,
+        bool& fits) const {
+    Shape shape;
+    fits = region.count() <= MAX_REGION_CELLS;
+    if (!fits) {
+        return shape;
+    }
+
+    unsigned top = board_rows, left = board_cols, bottom = 0, right = 0;
+    Bitboard cells{region};
+    while (cells.any()) {
+        const unsigned cell = cells.pop_lowest();
+        top = std::min(top, cell / board_cols);
+        bottom = std::max(bottom, cell / board_cols);
+        left = std::min(left, cell % board_cols);
+        right = std::max(right, cell % board_cols);
+    }
+    if (bottom - top >= MAX_SIDE || right - left >= MAX_SIDE) {
+        fits = false;
+        return shape;
+    }
+
+    shape.rows = bottom - top + 1;
+    shape.cols = right - left + 1;
+    cells = region;
+    while (cells.any()) {
+        const unsigned cell = cells.pop_lowest();
+        shape.row[cell / board_cols - top] |= 1 << (cell % board_cols - left);
+    }
+    return shape;
+}
+
+std::string RegionSolver::to_string(const value_t g) const {
+    if (g == ZERO) {
+        return "0";
+    }
+    // Options are sorted by form number, which depends on the order forms
+    // were found in; sorted by text, equal values read the same
+    std::string s = "{";
+    for (const std::vector<value_t>* options :
+            {&forms[g].left, &forms[g].right}) {
+        std::vector<std::string> texts;
+        for (const value_t option : *options) {
+            texts.push_back(to_string(option));
+        }
+        std::sort(texts.begin(), texts.end());
+        for (std::size_t i = 0; i < texts.size(); i++) {
+            s += (i ? "," : "") + texts[i];
+        }
+        s += options == &forms[g].left ? "|" : "}";
+    }
+    return s;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
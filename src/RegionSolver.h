@@ -0,0 +1,339 @@
+#ifndef REGION_SOLVER_H_
+#define REGION_SOLVER_H_
+
+#include "Bitboard.h"
+#include "GameState.h"
+#include "Tablebase.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * Solves Domineering endgames with combinatorial game theory.
+ *
+ * Late in the game the empty cells fall apart into regions that no domino
+ * can connect, and the position is the sum of the games played in each
+ * region. The solver computes the value of every region on its own, in
+ * canonical form, and adds them up. HOME is Left (horizontal dominoes) and
+ * AWAY is Right (vertical dominoes).
+ *
+ * Values of regions are cached by shape, so a region is only solved once no
+ * matter where on the board it shows up. Shapes that are mirror images of
+ * each other (left to right or top to bottom) have the same value and share
+ * an entry. So do a shape and its transpose (rows and columns swapped),
+ * whose value is the negative: transposing turns HOME's dominoes into
+ * AWAY's (see use_transposes). On top of that, the cells of every region
+ * decompose has seen are cached as they are, which is much cheaper to look
+ * up during a search. Shapes that were solved offline are read from a
+ * tablebase instead of being solved again (see use_tablebase).
+ *
+ * A solver is not thread safe; every search thread has its own.
+ */
+class RegionSolver {
+public:
+    /**
+     * A game value in canonical form: an index into the solver's table of
+     * forms. Two values are equal if and only if their indices are.
+     */
+    using value_t = unsigned;
+
+    /**
+     * The game 0 = { | }.
+     */
+    static const value_t ZERO = 0;
+
+    /**
+     * Regions with more cells than this are not solved.
+     */
+    static const unsigned MAX_REGION_CELLS = 16;
+
+    /**
+     * Rows and columns of a shape.
+     */
+    static const unsigned MAX_SIDE = 16;
+
+    /**
+     * The cells of a region, moved so that its first row and first column
+     * are used. Bit c of row[r] is the cell in row r, column c.
+     */
+    struct Shape {
+        Shape();
+
+        unsigned rows, cols;
+        std::uint16_t row[MAX_SIDE];
+
+        /**
+         * \return the number of cells.
+         */
+        unsigned size() const;
+
+        /**
+         * \return a string that is the same for equal shapes.
+         */
+        std::string key() const;
+
+        /**
+         * \return the mirror image with the smallest key, so that mirror
+         *         images come out the same.
+         */
+        Shape normalized() const;
+
+        /**
+         * Like normalized, but the mirror images of the transpose are
+         * candidates too.
+         *
+         * \param[out] transposed set to true if the result is a mirror
+         *                        image of the transpose, whose value is the
+         *                        negative of this shape's.
+         *
+         * \return the candidate with the smallest key.
+         */
+        Shape canonical(bool& transposed) const;
+
+        /**
+         * \return the shape moved up and to the left as far as it goes.
+         */
+        Shape trimmed() const;
+
+        Shape flip_horizontal() const;
+        Shape flip_vertical() const;
+
+        /**
+         * \return the shape with rows and columns swapped.
+         */
+        Shape transposed() const;
+    };
+
+    /**
+     * What decompose found out about a position.
+     */
+    struct Decomposition {
+        Decomposition();
+
+        /* True if every region was solved */
+        bool solved;
+
+        /* Value of the whole board; only set if `solved' */
+        value_t value;
+
+        /**
+         * Cells of solved regions that are 0, or that cancel out in pairs
+         * (G and -G). Leaving them out of the game does not change who
+         * wins.
+         */
+        Bitboard resolved;
+    };
+
+    /**
+     * \param[in] rows number of rows of the board.
+     *
+     * \param[in] cols number of columns of the board.
+     */
+    RegionSolver(const unsigned rows, const unsigned cols);
+
+    /**
+     * Splits the empty cells into regions and solves the small ones.
+     *
+     * \param[in] empty the empty cells of the board.
+     */
+    Decomposition decompose(const Bitboard& empty);
+
+    /**
+     * \return the value of a region.
+     */
+    value_t value(const Shape& shape);
+
+    /**
+     * \return the value of the sum a + b.
+     */
+    value_t add(const value_t a, const value_t b);
+
+    /**
+     * \return the value of -g, the game g with the roles of the players
+     *         swapped.
+     */
+    value_t negate(const value_t g);
+
+    /**
+     * \return true if a <= b, i.e. Left does at least as well in a as in b.
+     */
+    bool less_equal(const value_t a, const value_t b);
+
+    /**
+     * \return true if the given team wins g when it moves first.
+     */
+    bool wins_moving_first(const value_t g, const Who team);
+
+    /**
+     * Looks up shapes in the given tablebase before solving them. The
+     * tablebase has to outlive the solver, or the next call to this.
+     *
+     * \param[in] tablebase the tablebase, or nullptr for none.
+     */
+    void use_tablebase(const Tablebase* tablebase);
+
+    /**
+     * Turns on or off sharing values between a shape and its transpose.
+     * On by default; off only to check that it makes no difference. Call
+     * before solving anything, or after clear.
+     *
+     * \param[in] transposes true to share.
+     */
+    void use_transposes(const bool transposes);
+
+    /**
+     * \return the number of shapes whose value is known.
+     */
+    std::size_t shape_count() const;
+
+    /**
+     * Writes every shape solved so far as a tablebase.
+     *
+     * \param[in] path the file to write.
+     *
+     * \return false if the file could not be written.
+     */
+    bool save(const std::string& path) const;
+
+    /**
+     * Forgets everything. Values handed out before are no longer valid.
+     */
+    void clear();
+
+    /**
+     * \return the number of forms in the table.
+     */
+    std::size_t size() const;
+
+    /**
+     * \return the value as {left options | right options}, for debugging.
+     *         Equal values give the same text, in this solver or another.
+     */
+    std::string to_string(const value_t g) const;
+
+private:
+    /**
+     * A game in canonical form: its options, sorted.
+     */
+    struct Form {
+        std::vector<value_t> left, right;
+    };
+
+    /**
+     * Hash of the cells of a region.
+     */
+    struct BitboardHash {
+        std::size_t operator()(const Bitboard& b) const;
+    };
+
+    /**
+     * The solver starts over when its table, or its cache of regions, gets
+     * bigger than this.
+     */
+    static const std::size_t MAX_FORMS = 1 << 20;
+
+    /* Marks a negative that is not known yet */
+    static const value_t NONE = 0xffffffff;
+
+    /**
+     * \return the value of a shape that is trimmed and normalized (or
+     *         canonical), looked up or solved.
+     */
+    value_t solve(const Shape& shape);
+
+    /**
+     * Sum of the values of the regions in a shape.
+     */
+    value_t sum_of_regions(const Shape& shape);
+
+    /**
+     * Splits a shape into its regions.
+     */
+    static std::vector<Shape> regions(const Shape& shape);
+
+    /**
+     * Builds the canonical form of { left | right }: removes dominated
+     * options and bypasses reversible ones.
+     */
+    value_t canonical(std::vector<value_t> left, std::vector<value_t> right);
+
+    /**
+     * Comparisons between a form in the table and one that is being built
+     * (given by its options).
+     */
+    bool less_equal(const value_t x,
+                    const std::vector<value_t>& left,
+                    const std::vector<value_t>& right);
+    bool less_equal(const std::vector<value_t>& left,
+                    const std::vector<value_t>& right,
+                    const value_t x);
+
+    /**
+     * \return the value of an already canonical form, adding it to the
+     *         table if it is new.
+     */
+    value_t intern(const std::vector<value_t>& left,
+                   const std::vector<value_t>& right);
+
+    /**
+     * \return the value of a form of the tablebase, adding it and its
+     *         options to the table.
+     */
+    value_t import(const Tablebase::form_t form);
+
+    /**
+     * \return the cells of the region of `empty' that contains `cell'.
+     */
+    Bitboard region_of(const Bitboard& empty, const unsigned cell) const;
+
+    /**
+     * \return the region as a shape. `fits' is set to false if the region
+     *         is too big to solve.
+     */
+    Shape to_shape(const Bitboard& region, bool& fits) const;
+
+    unsigned board_rows, board_cols;
+
+    /* Cells that have a neighbour to the left and to the right */
+    Bitboard not_first_column, not_last_column;
+
+    std::vector<Form> forms;
+    std::unordered_map<std::string, value_t> form_index;
+    std::unordered_map<std::uint64_t, bool> comparisons;
+    std::unordered_map<std::uint64_t, value_t> sums;
+    std::vector<value_t> negatives;
+    std::unordered_map<std::string, value_t> shapes;
+    std::unordered_map<Bitboard, value_t, BitboardHash> placed;
+
+    const Tablebase* tablebase;
+    /* Whether a shape and its transpose share a value */
+    bool transposes;
+    /* Forms of the tablebase that are in the table, and where */
+    std::unordered_map<Tablebase::form_t, value_t> imported;
+};
+
+inline std::size_t RegionSolver::size() const {
+    return forms.size();
+}
+
+inline std::size_t RegionSolver::shape_count() const {
+    return shapes.size();
+}
+
+inline void RegionSolver::use_transposes(const bool transposes) {
+    this->transposes = transposes;
+}
+
+inline bool RegionSolver::wins_moving_first(const value_t g, const Who team) {
+    // Left wins moving first unless g <= 0, Right unless g >= 0
+    return team == Who::HOME
+        ? !less_equal(g, ZERO)
+        : !less_equal(ZERO, g);
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -1,42 +1,138 @@
 #include "Searcher.h"
+#include "Settings.h"
+
+#include "MappedFile.h"
+
+#include <cctype>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <utility>
+
+const unsigned long Searcher::CLOCK_CHECK_MASK;
+const unsigned Searcher::SPLIT_DEPTH;
+const unsigned Searcher::REGION_EMPTIES;
+
+namespace {
+    Searcher::Parallel parallel_setting() {
+        return Settings::get().parallel() == "YBWC"
+            ? Searcher::Parallel::YBWC
+            : Searcher::Parallel::LAZY_SMP;
+    }
+
+    Searcher::Algorithm algorithm_setting() {
+        const std::string search = Settings::get().search();
+        if (search == "PVS") {
+            return Searcher::Algorithm::PVS;
+        }
+        if (search == "MTDF") {
+            return Searcher::Algorithm::MTDF;
+        }
+        return Searcher::Algorithm::ALPHA_BETA;
+    }
+
+    BoardKernels::Isa kernels_setting() {
+        const std::string kernels = Settings::get().kernels();
+        for (const BoardKernels::Isa isa : {BoardKernels::Isa::SCALAR,
+                BoardKernels::Isa::SSE2, BoardKernels::Isa::AVX2}) {
+            std::string name{BoardKernels::name(isa)};
+            std::transform(name.begin(), name.end(), name.begin(),
+                    ::toupper);
+            if (kernels == name && BoardKernels::supported(isa)) {
+                return isa;
+            }
+        }
+        return BoardKernels::best();
+    }
+
+    using score_t = Evaluator::score_t;
+
+    /**
+     * \return the score seen from the other side. The infinities are not
+     *         symmetric, so they are swapped rather than negated.
+     */
+    score_t negate(const score_t score) {
+        if (score == AlphaBeta::POS_INF) {
+            return AlphaBeta::NEG_INF;
+        }
+        if (score == AlphaBeta::NEG_INF) {
+            return AlphaBeta::POS_INF;
+        }
+        return -score;
+    }
+
+    /**
+     * \return the score for `team' of a score for HOME, or the other way
+     *         round.
+     */
+    score_t for_team(const score_t score, const Who team) {
+        return team == Who::HOME ? score : negate(score);
+    }
+} // namespace
 
 /* Constructors, destructor, and assignment operator {{{ */
-Searcher::Searcher() {
-    move_thread = std::thread(&Searcher::move_order, this, Who::HOME);
+Searcher::Searcher()
+    : threads{Settings::get().threads()}
+    , parallel{parallel_setting()}
+    , algorithm{algorithm_setting()}
+    , regions{Settings::get().regions()}
+    , kernels{kernels_setting()}
+{
 }
 
-Searcher::Searcher(std::ifstream& ifs) {
-    move_thread = std::thread(&Searcher::move_order, this, Who::HOME);
+Searcher::Searcher(std::ifstream& ifs)
+    : threads{Settings::get().threads()}
+    , parallel{parallel_setting()}
+    , algorithm{algorithm_setting()}
+    , regions{Settings::get().regions()}
+    , kernels{kernels_setting()}
+{
+    // An invalid snapshot, or one of another board size, leaves the table
+    // empty
+    const DomineeringState board;
+    tp_table.load(ifs, board.ROWS, board.COLS);
 }
 
 Searcher::Searcher(const Searcher& other)
     : root{other.root}
-    , best_moves{other.best_moves}
-    , ordered_moves{other.ordered_moves}
+    , threads{other.threads}
+    , parallel{other.parallel}
+    , algorithm{other.algorithm}
+    , regions{other.regions}
+    , kernels{other.kernels}
+    , report{other.report}
     , tp_table{other.tp_table}
     , timer{other.timer}
 {
-    move_thread = std::thread(&Searcher::move_order, this, Who::HOME);
 }
 
 Searcher::Searcher(Searcher&& other)
     : root{std::move(other.root)}
-    , best_moves{std::move(other.best_moves)}
-    , ordered_moves{std::move(other.ordered_moves)}
+    , threads{other.threads}
+    , parallel{other.parallel}
+    , algorithm{other.algorithm}
+    , regions{other.regions}
+    , kernels{other.kernels}
+    , report{other.report}
     , tp_table{std::move(other.tp_table)}
     , timer{std::move(other.timer)}
 {
-    move_thread = std::thread(&Searcher::move_order, this, Who::HOME);
 }
 
 Searcher::~Searcher() {
+    stop_pondering();
 }
 
 Searcher& Searcher::operator=(const Searcher& other) {
     root = other.root;
-    best_moves = other.best_moves;
-    ordered_moves = other.ordered_moves;
+    threads = other.threads;
+    parallel = other.parallel;
+    algorithm = other.algorithm;
+    regions = other.regions;
+    kernels = other.kernels;
+    report = other.report;
     tp_table = other.tp_table;
     timer = other.timer;
 
@@ -45,8 +141,12 @@ Searcher& Searcher::operator=(const Searcher& other) {
 
 Searcher& Searcher::operator=(Searcher&& other) {
     root = std::move(other.root);
-    best_moves = std::move(other.best_moves);
-    ordered_moves = std::move(other.ordered_moves);
+    threads = other.threads;
+    parallel = other.parallel;
+    algorithm = other.algorithm;
+    regions = other.regions;
+    kernels = other.kernels;
+    report = other.report;
     tp_table = std::move(other.tp_table);
     timer = std::move(other.timer);
 
@@ -54,231 +154,1037 @@ Searcher& Searcher::operator=(Searcher&& other) {
 }
 /* }}} */
 
+Searcher::Result::Result()
+    : score{0}
+    , depth{0}
+{
+}
+
+Searcher::Worker::Worker(const unsigned id,
+        const DomineeringState& state,
+        const bool incremental,
+        RegionSolver* solver)
+    : id{id}
+    , state{state}
+    , eval{incremental
+            ? IncrementalEvaluator(state)
+            : IncrementalEvaluator()}
+    , nodes{0}
+    , aborted{false}
+    , split{nullptr}
+    , solver{solver}
+    , ordering(state.ROWS, state.COLS)
+    , moves(state.ROWS, state.COLS)
+    , pv(state.ROWS, state.COLS)
+    , on_pv{0}
+{
+}
+
+Searcher::SplitPoint::SplitPoint(SplitPoint* parent,
+        const unsigned ply,
+        const AlphaBeta& ab,
+        const DomineeringState& state,
+        const IncrementalEvaluator& eval,
+        const MoveStack::move_t* children,
+        const unsigned count,
+        const unsigned depth_limit,
+        const Frame& best)
+    : parent{parent}
+    , ply{ply}
+    , state{state}
+    , eval{eval}
+    , team{state.getWho()}
+    , children{children}
+    , count{count}
+    , depth_limit{depth_limit}
+    , ab{ab}
+    , best{best}
+    , next{1}
+    , active{0}
+    , aborted{false}
+    , stopped{false}
+{
+}
+
+bool Searcher::load_tablebase(const std::string& path) {
+    stop_pondering();
+    const bool loaded = tablebase.open(path);
+    for (const auto& solver : solvers) {
+        solver->use_tablebase(loaded ? &tablebase : nullptr);
+    }
+    return loaded;
+}
+
+bool Searcher::save_table(const std::string& path) {
+    stop_pondering();
+    // The entries are for the board size in the config
+    const DomineeringState board;
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    return tp_table.save(ofs, board.ROWS, board.COLS);
+}
+
+bool Searcher::load_table(const std::string& path) {
+    stop_pondering();
+    const DomineeringState board;
+    MappedFile file;
+    return file.open(path) && tp_table.load(file.data(), file.size(),
+            board.ROWS, board.COLS);
+}
+
+void Searcher::set_root(const Node& root) {
+    // The ponder thread searches from `root' too
+    stop_pondering();
+    this->root = root;
+}
+
 void Searcher::reset() {
     tp_table.clear();
 }
 
 Node Searcher::search(const DomineeringState& state,
         const unsigned depth_limit) {
-    if (root.team != last_team) {
-        last_team = root.team;
-        timer = Timer(240);
+    start_search();
+
+    std::vector<Worker> workers = make_workers(state);
+    deadline = clock::time_point::max();
+    search_iteration(workers, depth_limit);
+
+    for (const Worker& worker : workers) {
+        nodes_searched += worker.nodes;
     }
 
+    return to_node(workers.front().completed, state);
+}
+
+Node Searcher::iterative_search(const DomineeringState& state) {
+    stop_pondering();
     timer.click();
 
-    move_thread.join();
+    // Every pair of moves fills four cells, so this is roughly how many
+    // more moves we will have to make
+    timer.set_moves_left(state.getEmpty().count() / 4);
+    Node best = iterative_search(state, timer.get_move_time(),
+            timer.get_hard_limit());
 
-    // Initialize best moves
-    best_moves.resize(depth_limit + 1);
-    std::fill(best_moves.begin(), best_moves.end(), Node());
+    timer.click();
+    return best;
+}
 
-    AlphaBeta ab(AlphaBeta::NEG_INF, AlphaBeta::POS_INF);
-    // Remove all the useless information currently stored in the table
-    tp_table.clear();
-    search_under(root, ab, state, depth_limit);
+Node Searcher::iterative_search(const DomineeringState& state,
+        const float budget,
+        const float hard_limit) {
+    stop_pondering();
+    const clock::time_point stop_at = clock::now()
+        + std::chrono::duration_cast<clock::duration>(
+                std::chrono::duration<float>(hard_limit));
 
-    move_thread = std::thread(&Searcher::move_order, this, root.team);
+    // Every ply fills two cells, so the game cannot last longer than this
+    const unsigned max_depth = std::max(1u, state.getEmpty().count() / 2);
 
-    timer.click();
+    // Ponder hit: the opponent played the reply we expected
+    Result resume;
+    if (ponder_result.depth > 0 && state.getKey() == ponder_key) {
+        resume = ponder_result;
+    }
+    ponder_result = Result();
 
-    return best_moves.front();
+    return to_node(deepen(state, max_depth, budget, stop_at, resume),
+            state);
 }
 
-void Searcher::search_under(const Node& base,
+Node Searcher::iterative_search(const DomineeringState& state,
+        const unsigned depth_limit) {
+    return to_node(deepen(state, depth_limit, INFINITY,
+                clock::time_point::max()), state);
+}
+
+void Searcher::start_pondering(const DomineeringState& state,
+        const Node& best) {
+    stop_pondering();
+    ponder_result = Result();
+    if (last_result.pv.size() < 2) {
+        return;
+    }
+
+    DomineeringState predicted{state};
+    if (!predicted.makeMove(best.parent_move.to_move())
+            || !predicted.makeMove(
+                last_result.pv[1].to_location(state.COLS).to_move())
+            || !predicted.hasMoves(predicted.getWho())) {
+        return;
+    }
+
+    ponder_key = predicted.getKey();
+    root = Node(predicted.getWho(), 0);
+    ponder_thread = std::thread(&Searcher::ponder, this, predicted);
+}
+
+void Searcher::stop_pondering() {
+    if (!ponder_thread.joinable()) {
+        return;
+    }
+    ponder_stop = true;
+    ponder_thread.join();
+    ponder_stop = false;
+}
+
+void Searcher::search_under(Worker& worker,
+        const unsigned ply,
         AlphaBeta ab,
-        const DomineeringState& current_state,
+        DomineeringState& current_state,
         const unsigned depth_limit) {
 
-    Node& current_best = best_moves[base.depth];
+    // Looking at the clock is slow, so only do it every so often
+    if ((++worker.nodes & CLOCK_CHECK_MASK) == 0
+            && (stop.load(std::memory_order_relaxed)
+                || ponder_stop.load(std::memory_order_relaxed)
+                || clock::now() >= deadline)) {
+        worker.aborted = true;
+    }
+    if (worker.aborted || cut_off(worker)) {
+        return;
+    }
+
+    const Who team = current_state.getWho();
+    Frame& frame = worker.frames[ply];
+    worker.pv.clear(ply);
 
     // Base case
-    if (base.depth >= depth_limit) {
-        current_best = base;
-        current_best.set_score(evaluate(current_state));
-        current_best.lower_limit = current_best.score();
-        current_best.upper_limit = current_best.score();
+    if (ply >= depth_limit) {
+        Bitboard moves;
+        if (ply > 0 && solve_regions(worker, ply, current_state, moves)) {
+            return;
+        }
+        frame.move = Move();
+        frame.score = leaf_score(worker, current_state);
         return;
     }
 
-    // Check for transpositions that were already explored
+    // Number of plies searched under this node
+    const unsigned depth = depth_limit - ply;
+
+    // Check for transpositions that were already explored. The root always
+    // needs a move to come out of the search, so it is never cut here.
     bool found;
     TranspositionTable::Entry entry;
     std::tie(entry, found) = tp_table.check(current_state);
-    if (found && ab.can_prune(entry, base.team)) {
+    if (found && ply > 0 && ab.can_prune(entry, team, depth)) {
         // Set score to the best value possible in our sub tree so that we get
         // chosen by the parent, but that won't happen because there already
         // is a better value somewhere in another sub tree.
-        current_best.set_score(base.team == Who::HOME
-                ? entry.lower_limit
-                : entry.upper_limit);
-        current_best.lower_limit = entry.lower_limit;
-        current_best.upper_limit = entry.upper_limit;
+        // No move comes with the score
+        frame.move = Move();
+        frame.score = team == Who::HOME
+            ? entry.lower_limit
+            : entry.upper_limit;
         return;
     }
 
-    std::vector<Node> children;
-    auto ordered = ordered_moves.find(current_state);
-    // Use move-ordered children if possible
-    if (base.depth == 0 && ordered != ordered_moves.end()) {
-        children = ordered->second;
-        ordered_moves.clear();
-    }
-    else {
-        children = expand(base, current_state);
+    // The root still has to come up with a move, so its regions are
+    // searched either way
+    Bitboard moves = current_state.movesFor(team);
+    if (ply > 0 && solve_regions(worker, ply, current_state, moves)) {
+        return;
     }
 
-    // `base' is a terminal node
-    if (children.empty()) {
-        current_best = base;
-        current_best.set_as_terminal(current_state);
+    // Terminal node: the team to move cannot place a domino, and loses
+    if (!moves.any()) {
+        frame.move = Move();
+        frame.score = team == Who::HOME
+            ? AlphaBeta::NEG_INF
+            : AlphaBeta::POS_INF;
         return;
     }
 
+    MoveStack::move_t* children = worker.moves.frame(ply);
+    const unsigned count = order_moves(worker, ply, team, moves,
+            found ? entry : TranspositionTable::Entry(), children);
+    if (ply == 0) {
+        order_root(worker, children, count);
+    }
+
     /*
      * Reset the score to POS_INF or NEG_INF depending on which team this node
      * belongs to.
      */
-    current_best.set_score(base.team == Who::HOME
-            ? AlphaBeta::NEG_INF
-            : AlphaBeta::POS_INF);
+    frame.score = team == Who::HOME
+        ? AlphaBeta::NEG_INF
+        : AlphaBeta::POS_INF;
+    // No child has been looked at yet. The first one is always taken, even
+    // if it loses, so that the node never ends up without a move.
+    frame.move = Move();
+
+    // The window this node was searched with. Used to tell an exact score
+    // from a limit when storing the result.
+    const AlphaBeta window{ab};
+
+    bool cutoff = false;
+    for (unsigned i = 0; i < count && !cutoff; i++) {
+        // The first child has been searched on its own. Let idle threads
+        // help with the rest.
+        if (i == 1 && parallel == Parallel::YBWC && threads > 1
+                && depth >= SPLIT_DEPTH) {
+            cutoff = split(worker, ply, ab, current_state, children, count,
+                    depth_limit, frame);
+            break;
+        }
 
-    DomineeringState next_state{current_state};
-    next_state.togglePlayer();
+        const Move move = children[i];
+        const bool follow = follows_pv(worker, ply, move);
+        worker.on_pv += follow;
 
-    for (Node& child : children) {
         // Update board to simulate placing the child.
         // Done so that we don't need to make a copy of state for each child.
-        tap(child, next_state);
+        tap(move, current_state, worker.eval);
 
         // Recursive call
-        search_under(child, ab, next_state, depth_limit);
+        search_under(worker, ply + 1, ab, current_state, depth_limit);
 
         // Rewind to board before placing the child
-        untap(child, next_state);
+        untap(move, current_state, worker.eval);
+        worker.on_pv -= follow;
+
+        // Ran out of time or the result is not needed anymore: nothing below
+        // is complete, so nothing is stored
+        if (worker.aborted || cut_off(worker)) {
+            return;
+        }
+
+        // Terminal nodes already carry their POS_INF/NEG_INF score
+        const Frame& next = worker.frames[ply + 1];
+        const score_t score = next.score;
+
+        bool result_better = team == Who::HOME
+            ? score > frame.score
+            : score < frame.score;
+        if (result_better || frame.move.is_none()) {
+            frame.move = move;
+            frame.score = score;
+            // The line goes on with what the child found best. It ends
+            // there if the child was a leaf or cut by the table.
+            worker.pv.update(ply, move);
+
+            ab.update_if_needed(score, team);
+            cutoff = ab.can_prune(score, team);
+            if (cutoff) {
+                worker.ordering.cutoff(ply, move, depth);
+            }
+        }
+    }
+
+    if (worker.aborted || cut_off(worker)) {
+        return;
+    }
+
+    if (cutoff) {
+        // The rest of the children were not searched, so the score is only
+        // a limit on the true value
+        tp_table.insert(current_state, frame.score,
+                team == Who::HOME
+                    ? TranspositionTable::Bound::LOWER
+                    : TranspositionTable::Bound::UPPER,
+                depth, frame.move);
+        return;
+    }
+
+    // Every child was searched. The score is exact unless no child reached
+    // the window, in which case it is only a limit.
+    // The best move is then no better than the others, and not stored.
+    score_t lower_limit = frame.score;
+    score_t upper_limit = frame.score;
+    bool failed_low = false;
+    if (team == Who::HOME && frame.score <= window.alpha) {
+        lower_limit = AlphaBeta::NEG_INF;
+        failed_low = true;
+    }
+    else if (team == Who::AWAY && frame.score >= window.beta) {
+        upper_limit = AlphaBeta::POS_INF;
+        failed_low = true;
+    }
+    // Add result to transposition table
+    tp_table.insert(current_state, lower_limit, upper_limit, depth,
+            failed_low ? Move() : frame.move);
+
+    return;
+}
+
+score_t Searcher::search_pvs(Worker& worker,
+        const unsigned ply,
+        score_t alpha,
+        const score_t beta,
+        DomineeringState& current_state,
+        const unsigned depth_limit) {
+
+    // Looking at the clock is slow, so only do it every so often
+    if ((++worker.nodes & CLOCK_CHECK_MASK) == 0
+            && (stop.load(std::memory_order_relaxed)
+                || ponder_stop.load(std::memory_order_relaxed)
+                || clock::now() >= deadline)) {
+        worker.aborted = true;
+    }
+    if (worker.aborted || cut_off(worker)) {
+        return 0;
+    }
+
+    const Who team = current_state.getWho();
+    Frame& frame = worker.frames[ply];
+    worker.pv.clear(ply);
+
+    // Base case
+    if (ply >= depth_limit) {
+        Bitboard moves;
+        if (ply == 0 || !solve_regions(worker, ply, current_state, moves)) {
+            frame.move = Move();
+            frame.score = leaf_score(worker, current_state);
+        }
+        return for_team(frame.score, team);
+    }
+
+    // Number of plies searched under this node
+    const unsigned depth = depth_limit - ply;
+
+    // The limits in the table are for HOME
+    bool found;
+    TranspositionTable::Entry entry;
+    std::tie(entry, found) = tp_table.check(current_state);
+    if (found && ply > 0 && entry.depth >= depth) {
+        const score_t lower = team == Who::HOME
+            ? entry.lower_limit : negate(entry.upper_limit);
+        const score_t upper = team == Who::HOME
+            ? entry.upper_limit : negate(entry.lower_limit);
+        score_t score = lower;
+        bool usable = lower == upper || lower >= beta;
+        if (!usable && upper <= alpha) {
+            score = upper;
+            usable = true;
+        }
+        if (usable) {
+            frame.move = Move();
+            frame.score = for_team(score, team);
+            return score;
+        }
+    }
+
+    Bitboard moves = current_state.movesFor(team);
+    if (ply > 0 && solve_regions(worker, ply, current_state, moves)) {
+        return for_team(frame.score, team);
+    }
+
+    // Terminal node: whoever cannot move loses
+    if (!moves.any()) {
+        frame.move = Move();
+        frame.score = for_team(AlphaBeta::NEG_INF, team);
+        return AlphaBeta::NEG_INF;
+    }
+
+    MoveStack::move_t* children = worker.moves.frame(ply);
+    const unsigned count = order_moves(worker, ply, team, moves,
+            found ? entry : TranspositionTable::Entry(), children);
+    if (ply == 0) {
+        order_root(worker, children, count);
+    }
+
+    // Used to tell an exact score from a limit when storing the result
+    const score_t original_alpha = alpha;
+    score_t best_score = AlphaBeta::NEG_INF;
+    frame.move = Move();
 
-        const Node& next_move{best_moves[base.depth + 1]};
+    for (unsigned i = 0; i < count; i++) {
+        const Move move = children[i];
+        const bool follow = follows_pv(worker, ply, move);
+        worker.on_pv += follow;
+        tap(move, current_state, worker.eval);
 
-        if (next_move.is_terminal()) {
-            child.set_as_terminal(next_state);
+        score_t score;
+        if (i == 0) {
+            score = negate(search_pvs(worker, ply + 1, negate(beta),
+                        negate(alpha), current_state, depth_limit));
         }
         else {
-            child.set_score(next_move.score());
-        }
-
-        current_best.update_limits(next_move);
-        current_best.descentdants_searched += next_move.descentdants_searched;
-
-        bool result_better = base.team == Who::HOME
-            ? child.score() > current_best.score()
-            : child.score() < current_best.score();
-        if (result_better || current_best.is_unset) {
-            current_best = child;
-
-            ab.update_if_needed(child.score(), base.team);
-            if (ab.can_prune(child.score(), base.team)) {
-                // Add result to transposition table
-                tp_table.insert(current_state,
-                        current_best.lower_limit,
-                        current_best.upper_limit,
-                        current_best.descentdants_searched);
-                return;
+            // Only find out whether the child beats alpha. Not
+            // negate(alpha + 1): NEG_INF + 1 negates to POS_INF.
+            score = negate(search_pvs(worker, ply + 1, negate(alpha) - 1,
+                        negate(alpha), current_state, depth_limit));
+            if (score > alpha && score < beta && !worker.aborted) {
+                score = negate(search_pvs(worker, ply + 1, negate(beta),
+                            negate(alpha), current_state, depth_limit));
             }
         }
+
+        untap(move, current_state, worker.eval);
+        worker.on_pv -= follow;
+
+        // Ran out of time or the result is not needed anymore: nothing below
+        // is complete, so nothing is stored
+        if (worker.aborted || cut_off(worker)) {
+            return 0;
+        }
+
+        if (score > best_score || frame.move.is_none()) {
+            best_score = score;
+            frame.move = move;
+            frame.score = for_team(score, team);
+            worker.pv.update(ply, move);
+        }
+        alpha = std::max(alpha, score);
+        if (alpha >= beta) {
+            worker.ordering.cutoff(ply, move, depth);
+            break;
+        }
     }
 
-    // Set true score since there was no pruning
-    current_best.lower_limit = current_best.score();
-    current_best.upper_limit = current_best.score();
-    // Add result to transposition table
+    // Seen from the side to move, then turned into limits for HOME. After a
+    // fail low the best move is no better than the others, and not stored.
+    TranspositionTable::Bound bound = TranspositionTable::Bound::EXACT;
+    Move best_move = frame.move;
+    if (best_score >= beta) {
+        bound = team == Who::HOME
+            ? TranspositionTable::Bound::LOWER
+            : TranspositionTable::Bound::UPPER;
+    }
+    else if (best_score <= original_alpha) {
+        bound = team == Who::HOME
+            ? TranspositionTable::Bound::UPPER
+            : TranspositionTable::Bound::LOWER;
+        best_move = Move();
+    }
     tp_table.insert(current_state,
-            current_best.lower_limit,
-            current_best.upper_limit,
-            current_best.descentdants_searched);
+            for_team(best_score, team), bound, depth, best_move);
 
-    return;
+    return best_score;
 }
 
 Evaluator::score_t Searcher::evaluate(const DomineeringState& state) {
-    // A copy of the state so that we can mark places temporarily and pass
-    // that around to various evaluators
-    DomineeringState state_copy{state};
-    using score_t = Evaluator::score_t;
-
-    score_t home_score = RESERVED_FACTOR * home_reserved(&state_copy)
-        + OPEN_FACTOR * home_open(&state_copy);
+    return kernels.features(state).score();
+}
 
-    clear_marks(&state_copy);
+void Searcher::new_game(const float game_time, const float move_time) {
+    timer = Timer(game_time, move_time);
+}
 
-    score_t away_score = RESERVED_FACTOR * away_reserved(&state_copy)
-        + OPEN_FACTOR * away_open(&state_copy);
+void Searcher::skip_search() {
+    stop_pondering();
+    // Nothing to ponder on without a search
+    last_result = Result();
+    timer.click();
+    timer.click();
+}
 
-    return home_score - away_score;
+void Searcher::server_time(const double secs) {
+    timer.server_time(secs);
 }
 
 void Searcher::cleanup() {
-    if (move_thread.joinable()) {
-        move_thread.join();
-    }
+    stop_pondering();
 }
 
 /* Private methods */
 
-std::vector<Node> Searcher::expand(const Node& base,
-        const DomineeringState& current_state) {
-    // Toggle player
-    Who child_team = base.team == Who::HOME ? Who::AWAY : Who::HOME;
-    unsigned child_depth = base.depth + 1;
-    std::vector<Node> children;
-
-    // Create one instance and modify the values so that we don't have to
-    // instantiate a ton of vectors in GameMove constructor.
-    DomineeringMove parent_move{0, 0, 0, 0};
-    for (unsigned r1 = 0; r1 < current_state.ROWS; r1++) {
-        for (unsigned c1 = 0; c1 < current_state.COLS; c1++) {
-            // Home places horizontally, Away places vertically
-            unsigned r2 = base.team == Who::HOME ? r1 : r1 + 1;
-            unsigned c2 = base.team == Who::HOME ? c1 + 1 : c1;
-
-            parent_move.setMv(r1, c1, r2, c2);
-
-            if (current_state.moveOK(parent_move)) {
-                // Note: my_move is HOW I got to this state i.e. base's move
-                children.push_back(Node(child_team,
-                            child_depth,
-                            Location(parent_move)));
+void Searcher::start_search() {
+    // Keep what was learned on earlier moves, but let it age
+    tp_table.new_search();
+
+    previous_pv.clear();
+    nodes_searched = 0;
+}
+
+Searcher::Result Searcher::deepen(const DomineeringState& state,
+        const unsigned depth_limit,
+        const float budget,
+        const clock::time_point stop_at,
+        const Result& resume,
+        const bool pondering) {
+    start_search();
+
+    const clock::time_point start = clock::now();
+    std::vector<Worker> workers = make_workers(state);
+
+    last_result = resume;
+    if (resume.depth > 0) {
+        // Search this line first in the next iteration
+        previous_pv = resume.pv;
+
+        // Already proven, or no time to improve on it
+        if (resume.score == AlphaBeta::POS_INF
+                || resume.score == AlphaBeta::NEG_INF
+                || timer.predict_next_iteration() > budget) {
+            return last_result;
+        }
+    }
+    else {
+        timer.start_iterations();
+    }
+
+    for (unsigned depth = resume.depth + 1; depth <= depth_limit; depth++) {
+        const clock::time_point iteration_start = clock::now();
+        const unsigned long nodes_before = nodes_searched;
+
+        // Depth 1 always runs to completion so that there is a move to play
+        deadline = depth == 1 ? clock::time_point::max() : stop_at;
+        search_iteration(workers, depth);
+
+        nodes_searched = 0;
+        const Worker* deepest = &workers.front();
+        for (const Worker& worker : workers) {
+            nodes_searched += worker.nodes;
+            // A helper that got deeper than the main thread is taken as is
+            if (worker.completed.depth > deepest->completed.depth) {
+                deepest = &worker;
             }
         }
+        if (deepest->completed.depth < depth) {
+            break;
+        }
+
+        last_result = deepest->completed;
+        depth = last_result.depth;
+        // Search this line first in the next iteration
+        previous_pv = last_result.pv;
+
+        const clock::time_point now = clock::now();
+        if (report != nullptr) {
+            report_iteration(last_result, state,
+                    std::chrono::duration<double>(now - start).count(),
+                    pondering);
+        }
+
+        // A proven win or loss does not change by looking deeper
+        if (workers.front().aborted
+                || last_result.score == AlphaBeta::POS_INF
+                || last_result.score == AlphaBeta::NEG_INF) {
+            break;
+        }
+
+        timer.record_iteration(nodes_searched - nodes_before,
+                std::chrono::duration<double>(now - iteration_start).count());
+
+        // Don't start an iteration that is not going to finish in time; it
+        // would only be thrown away
+        const double elapsed =
+            std::chrono::duration<double>(now - start).count();
+        if (elapsed + timer.predict_next_iteration() > budget) {
+            break;
+        }
+    }
+
+    return last_result;
+}
+
+void Searcher::ponder(const DomineeringState state) {
+    const unsigned max_depth = std::max(1u, state.getEmpty().count() / 2);
+    ponder_result = deepen(state, max_depth, INFINITY,
+            clock::time_point::max(), Result(), true);
+}
+
+void Searcher::report_iteration(const Result& result,
+        const DomineeringState& state,
+        const double seconds,
+        const bool pondering) const {
+    std::ostringstream line;
+    line << (pondering ? "ponder" : "search")
+        << " depth " << result.depth
+        << " score " << for_team(result.score, state.getWho())
+        << " nodes " << nodes_searched
+        << " time " << std::fixed << std::setprecision(3) << seconds
+        << " nps " << std::setprecision(0)
+        << (seconds > 0 ? nodes_searched / seconds : 0.0)
+        << " pv";
+    for (const Move move : result.pv) {
+        line << ' ' << move.cell() / state.COLS << ','
+            << move.cell() % state.COLS << (move.vertical() ? 'v' : 'h');
+    }
+    // One write, so that lines of several searchers do not interleave
+    *report << line.str() + '\n' << std::flush;
+}
+
+Node Searcher::to_node(const Result& result,
+        const DomineeringState& state) const {
+    const Who team = state.getWho();
+    if (result.pv.empty()) {
+        // The root has no moves and is lost
+        Node node(team, 0);
+        node.set_as_terminal();
+        return node;
+    }
+
+    Node node(team == Who::HOME ? Who::AWAY : Who::HOME, 1,
+            result.pv.front().to_location(state.COLS));
+    node.set_score(result.score);
+    return node;
+}
+
+std::vector<Searcher::Worker>
+Searcher::make_workers(const DomineeringState& state) {
+    while (solvers.size() < threads) {
+        solvers.emplace_back(new RegionSolver(state.ROWS, state.COLS));
+        if (tablebase.is_open()) {
+            solvers.back()->use_tablebase(&tablebase);
+        }
+    }
+
+    const bool incremental = incremental_eval(state);
+    std::vector<Worker> workers;
+    for (unsigned id = 0; id < threads; id++) {
+        workers.emplace_back(id, state, incremental, solvers[id].get());
+    }
+    return workers;
+}
+
+void Searcher::search_iteration(std::vector<Worker>& workers,
+        const unsigned depth_limit) {
+    stop = false;
+
+    // Split points are only made by search_under
+    std::vector<std::thread> helpers;
+    if (parallel == Parallel::YBWC && algorithm != Algorithm::PVS) {
+        split_queues.reset(new SplitQueue[workers.size()]);
+        for (unsigned id = 1; id < workers.size(); id++) {
+            helpers.emplace_back(&Searcher::help, this,
+                    std::ref(workers[id]), depth_limit);
+        }
+    }
+    else {
+        for (unsigned id = 1; id < workers.size(); id++) {
+            // Every other helper looks one ply deeper
+            helpers.emplace_back(&Searcher::search_to_depth, this,
+                    std::ref(workers[id]), depth_limit + id % 2);
+        }
+    }
+
+    search_to_depth(workers.front(), depth_limit);
+
+    // The main thread has a result; whatever the helpers were doing is no
+    // longer needed
+    stop = true;
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+}
+
+void Searcher::search_to_depth(Worker& worker, const unsigned depth_limit) {
+    worker.frames.assign(depth_limit + 1, Frame{Move(), 0});
+
+    worker.aborted = false;
+    worker.on_pv = 0;
+    if (algorithm == Algorithm::PVS) {
+        search_pvs(worker, 0, AlphaBeta::NEG_INF, AlphaBeta::POS_INF,
+                worker.state, depth_limit);
+    }
+    else if (algorithm == Algorithm::MTDF) {
+        search_mtdf(worker, depth_limit);
+    }
+    else {
+        AlphaBeta ab(AlphaBeta::NEG_INF, AlphaBeta::POS_INF);
+        search_under(worker, 0, ab, worker.state, depth_limit);
+    }
+
+    if (!worker.aborted && depth_limit >= worker.completed.depth) {
+        worker.completed.pv = worker.pv.line(0);
+        worker.completed.score = worker.frames.front().score;
+        worker.completed.depth = depth_limit;
     }
-    return children;
 }
 
-void Searcher::move_order(Who team) {
-    for (auto& p : ordered_moves) {
-        auto& moves = p.second;
-        if (team == Who::HOME) {
-            std::sort(moves.begin(), moves.end(), std::greater<Node>());
+void Searcher::search_mtdf(Worker& worker, const unsigned depth_limit) {
+    score_t guess = worker.completed.depth > 0
+        ? worker.completed.score : 0;
+    score_t lower = AlphaBeta::NEG_INF;
+    score_t upper = AlphaBeta::POS_INF;
+
+    // Scores are for HOME. A pass that goes against the side to move only
+    // limits every root move (HOME failing low, AWAY failing high), so the
+    // move comes from the last pass that went its way: the one that raised
+    // `lower' for HOME, or lowered `upper' for AWAY
+    const bool home = worker.state.getWho() == Who::HOME;
+    Move best;
+    std::vector<Move> line;
+    bool proved = false;
+
+    while (lower < upper) {
+        // Window (beta - 1, beta): is the score at least beta?
+        const score_t beta = guess == lower ? guess + 1 : guess;
+        search_under(worker, 0, AlphaBeta(beta - 1, beta), worker.state,
+                depth_limit);
+        if (worker.aborted) {
+            return;
+        }
+
+        guess = worker.frames.front().score;
+        if (guess < beta) {
+            upper = guess;
         }
         else {
-            std::sort(moves.begin(), moves.end(), std::less<Node>());
+            lower = guess;
+        }
+        const bool for_mover = home == (guess >= beta);
+        if (for_mover || !proved) {
+            best = worker.frames.front().move;
+            line = worker.pv.line(0);
+            proved = proved || for_mover;
+        }
+    }
+
+    worker.frames.front().move = best;
+    worker.frames.front().score = lower;
+    worker.pv.assign(0, line);
+}
+
+bool Searcher::solve_regions(Worker& worker,
+        const unsigned ply,
+        const DomineeringState& state,
+        Bitboard& moves) {
+    if (!regions || state.getEmpty().count() > REGION_EMPTIES) {
+        return false;
+    }
+
+    const RegionSolver::Decomposition parts =
+        worker.solver->decompose(state.getEmpty());
+    if (!parts.solved) {
+        // Regions that add up to 0 do not change who wins: whoever needs
+        // a move there gets answered there
+        moves &= ~parts.resolved;
+        return false;
+    }
+
+    const Who team = state.getWho();
+    const bool home_wins =
+        worker.solver->wins_moving_first(parts.value, team)
+        == (team == Who::HOME);
+    const score_t score = home_wins ? AlphaBeta::POS_INF : AlphaBeta::NEG_INF;
+    Frame& frame = worker.frames[ply];
+    frame.move = Move();
+    frame.score = score;
+    tp_table.insert(state, score, score,
+            TranspositionTable::PROVEN_DEPTH);
+    return true;
+}
+
+void Searcher::order_root(const Worker& worker,
+        MoveStack::move_t* children,
+        const unsigned count) const {
+    MoveStack::move_t* first = children;
+    MoveStack::move_t* end = children + count;
+    // Best move of the previous iteration goes first
+    if (!previous_pv.empty()) {
+        MoveStack::move_t* pv = std::find(children, end, previous_pv.front());
+        if (pv != end) {
+            std::rotate(children, pv, pv + 1);
+            ++first;
+        }
+    }
+    // Every helper thread starts the other moves somewhere else
+    if (first != end) {
+        std::rotate(first, first + worker.id % (end - first), end);
+    }
+}
+
+bool Searcher::cut_off(const Worker& worker) const {
+    for (const SplitPoint* sp = worker.split; sp != nullptr; sp = sp->parent) {
+        if (sp->stopped.load(std::memory_order_relaxed)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Searcher::split(Worker& worker,
+        const unsigned ply,
+        AlphaBeta& ab,
+        DomineeringState& state,
+        const MoveStack::move_t* children,
+        const unsigned count,
+        const unsigned depth_limit,
+        Frame& best) {
+    SplitPoint sp(worker.split, ply, ab, state, worker.eval, children,
+            count, depth_limit, best);
+    SplitQueue& queue = split_queues[worker.id];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.splits.push_back(&sp);
+    }
+
+    // The owner takes children like everybody else
+    std::size_t index = count;
+    {
+        std::lock_guard<std::mutex> lock(sp.mutex);
+        if (sp.next < count) {
+            index = sp.next++;
+        }
+    }
+    if (index < count) {
+        search_split(worker, sp, state, index);
+    }
+
+    // Nobody can join once the split point is out of the queue; wait for
+    // the ones that did
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.splits.pop_back();
+    }
+    std::unique_lock<std::mutex> lock(sp.mutex);
+    sp.done.wait(lock, [&sp] { return sp.active == 0; });
+
+    if (sp.aborted) {
+        worker.aborted = true;
+    }
+    ab = sp.ab;
+    if (sp.best.move != best.move) {
+        worker.pv.update(ply, sp.best.move, sp.line);
+    }
+    best = sp.best;
+    return sp.stopped.load(std::memory_order_relaxed);
+}
+
+void Searcher::search_split(Worker& worker,
+        SplitPoint& sp,
+        DomineeringState& state,
+        std::size_t index) {
+    SplitPoint* const saved = worker.split;
+    worker.split = &sp;
+    const Who team = sp.team;
+
+    while (true) {
+        const Move move = sp.children[index];
+        AlphaBeta ab;
+        {
+            std::lock_guard<std::mutex> lock(sp.mutex);
+            ab = sp.ab;
+        }
+
+        tap(move, state, worker.eval);
+        search_under(worker, sp.ply + 1, ab, state, sp.depth_limit);
+        untap(move, state, worker.eval);
+
+        std::lock_guard<std::mutex> lock(sp.mutex);
+        if (worker.aborted) {
+            sp.aborted = true;
+        }
+        else if (!cut_off(worker)) {
+            const Frame& next = worker.frames[sp.ply + 1];
+            bool result_better = team == Who::HOME
+                ? next.score > sp.best.score
+                : next.score < sp.best.score;
+            if (result_better) {
+                sp.best.move = move;
+                sp.best.score = next.score;
+                sp.line = worker.pv.line(sp.ply + 1);
+                sp.ab.update_if_needed(next.score, team);
+                if (sp.ab.can_prune(next.score, team)) {
+                    sp.stopped = true;
+                    worker.ordering.cutoff(sp.ply, move,
+                            sp.depth_limit - sp.ply);
+                }
+            }
+        }
+
+        if (worker.aborted || cut_off(worker)
+                || sp.next >= sp.count) {
+            break;
+        }
+        index = sp.next++;
+    }
+
+    worker.split = saved;
+}
+
+bool Searcher::steal(Worker& worker) {
+    for (unsigned i = 1; i < threads; i++) {
+        SplitQueue& queue = split_queues[(worker.id + i) % threads];
+        SplitPoint* sp = nullptr;
+        std::size_t index = 0;
+        {
+            std::lock_guard<std::mutex> queue_lock(queue.mutex);
+            for (SplitPoint* candidate : queue.splits) {
+                std::lock_guard<std::mutex> lock(candidate->mutex);
+                if (!candidate->stopped.load(std::memory_order_relaxed)
+                        && candidate->next < candidate->count) {
+                    index = candidate->next++;
+                    // Keeps the owner waiting until we are done
+                    candidate->active++;
+                    sp = candidate;
+                    break;
+                }
+            }
+        }
+        if (sp == nullptr) {
+            continue;
         }
 
-        for (Node s : moves) std::cout << s.score();
-        std::cout << std::endl;
+        // The worker taps onto a copy of the split point's state, so its
+        // features have to follow until it is done
+        DomineeringState state{sp->state};
+        IncrementalEvaluator eval{sp->eval};
+        std::swap(worker.eval, eval);
+        search_split(worker, *sp, state, index);
+        std::swap(worker.eval, eval);
+
+        std::lock_guard<std::mutex> lock(sp->mutex);
+        if (--sp->active == 0) {
+            // Notified under the lock: `sp' is gone once the owner wakes up
+            sp->done.notify_one();
+        }
+        return true;
+    }
+    return false;
+}
+
+void Searcher::help(Worker& worker, const unsigned depth_limit) {
+    worker.frames.resize(depth_limit + 1);
+    worker.aborted = false;
+    worker.on_pv = 0;
+
+    while (!stop.load(std::memory_order_relaxed)) {
+        if (!steal(worker)) {
+            std::this_thread::yield();
+        }
     }
 }
 
-void Searcher::tap(const Node& node, DomineeringState& state) {
-    // To reflect the base's team, flip the symbols
-    char c = node.team == Who::HOME ? state.AWAYSYM : state.HOMESYM;
-    state.setCell(node.parent_move.r1, node.parent_move.c1, c);
-    state.setCell(node.parent_move.r2, node.parent_move.c2, c);
+unsigned Searcher::order_moves(const Worker& worker,
+        const unsigned ply,
+        const Who team,
+        const Bitboard& moves,
+        const TranspositionTable::Entry& entry,
+        MoveStack::move_t* children) const {
+    // The move of the previous principal variation goes first as long as
+    // the path follows it, the one the table remembers everywhere else. A
+    // move of the wrong orientation comes from another position with the
+    // same key, and is left out by the ordering.
+    Move first;
+    Move after_killers;
+    if (worker.on_pv == ply && ply < previous_pv.size()) {
+        first = previous_pv[ply];
+    }
+    else if (!entry.move.is_none()) {
+        // Only an exact score makes the move the best one. After a cutoff
+        // it merely was good enough, and the killers do better.
+        if (entry.lower_limit == entry.upper_limit) {
+            first = entry.move;
+        }
+        else {
+            after_killers = entry.move;
+        }
+    }
+
+    return worker.ordering.order(moves, team, ply, first, after_killers,
+            children);
+}
+
+void Searcher::tap(const Move move,
+        DomineeringState& state,
+        IncrementalEvaluator& eval) {
+    // Home places horizontally, Away places vertically
+    state.placeDomino(move.cell(), move.team());
+    state.togglePlayer();
+    eval.tap(move);
 }
 
-void Searcher::untap(const Node& node, DomineeringState& state) {
-    char c = state.EMPTYSYM;
-    state.setCell(node.parent_move.r1, node.parent_move.c1, c);
-    state.setCell(node.parent_move.r2, node.parent_move.c2, c);
+void Searcher::untap(const Move move,
+        DomineeringState& state,
+        IncrementalEvaluator& eval) {
+    state.removeDomino(move.cell(), move.team());
+    state.togglePlayer();
+    eval.untap(move);
 }
 
 /* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -2,27 +2,85 @@
 #define SEARCHER_H_
 
 #include "AlphaBeta.h"
+#include "BoardKernels.h"
 #include "DomineeringState.h"
 #include "Evaluators.h"
+#include "IncrementalEvaluator.h"
 #include "Location.h"
+#include "Move.h"
+#include "MoveOrdering.h"
+#include "MoveStack.h"
 #include "Node.h"
+#include "PrincipalVariation.h"
+#include "RegionSolver.h"
+#include "Tablebase.h"
 #include "TranspositionTable.h"
 #include "Timer.h"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <fstream>
+#include <memory>
+#include <mutex>
+#include <ostream>
 #include <unordered_map>
 #include <vector>
-#include <unordered_map>
 #include <thread>
 
 /**
  * A class that performs alpha-beta search in the game of Domineering to find
  * the best possible move for the current turn.
+ *
+ * The search can run on several threads (Lazy SMP). Every thread searches
+ * the whole tree from the root on its own copy of the state, and they only
+ * share the transposition table. Half of the helper threads look one ply
+ * deeper than the main thread, and each one tries the root moves in a
+ * different order, so that they fill the table with results the main thread
+ * is about to need.
+ *
+ * The other way of searching on several threads is Young Brothers Wait
+ * (YBWC). Only the main thread starts at the root. Once the first child of
+ * a node has been searched, the rest of the children are put up as a split
+ * point, and idle threads steal them one at a time. A cutoff at a split
+ * point stops every thread working below it.
+ *
+ * While the opponent thinks, the searcher ponders: it searches the position
+ * after the reply it expects, on one more thread (see start_pondering). If
+ * the opponent does play that reply, the next search picks up where the
+ * pondering stopped. Either way the transposition table keeps what was
+ * found.
+ *
+ * Late in the game, when the empty cells have fallen apart into small
+ * regions, the searcher solves them exactly (see RegionSolver). If every
+ * region is solved the winner is known without searching any further;
+ * otherwise regions that cancel each other out are left out of the search.
+ * This is also done at the leaves, so that a leaf whose regions are all
+ * solved gets its exact result instead of a heuristic score. Shapes found
+ * in the tablebase (see load_tablebase) are not solved again.
  */
 
 class Searcher {
 public:
+    /**
+     * How several threads share the work (see Settings::parallel).
+     */
+    enum class Parallel {
+        LAZY_SMP,
+        YBWC
+    };
+
+    /**
+     * How each thread searches the tree (see Settings::search).
+     */
+    enum class Algorithm {
+        ALPHA_BETA,
+        PVS,
+        MTDF
+    };
+
     // Default constructor
     Searcher();
 
@@ -30,7 +88,9 @@ public:
      * Instantiates a searcher and read the transposition table from the given
      * ifstream.
      *
-     * \param[in] ifs the ifstream to read the transposition table from.
+     * \param[in] ifs the ifstream to read the transposition table from, a
+     *                snapshot written by save_table. If it is not valid, the
+     *                table starts empty.
      */
     Searcher(std::ifstream& ifs);
 
@@ -49,7 +109,7 @@ public:
     Searcher& operator=(Searcher&& other);
 
     /**
-     * Gives a starting point to this searcher.
+     * Gives a starting point to this searcher. Stops pondering first.
      *
      * \param[in] root the root of the search tree.
      */
@@ -61,7 +121,8 @@ public:
     void reset();
 
     /**
-     * Searches for moves until it reaches the given depth.
+     * Searches for moves until it reaches the given depth. Helper threads
+     * are stopped as soon as the main thread is done.
      *
      * \param[in] state current state of the game configuration.
      *
@@ -72,23 +133,67 @@ public:
     Node search(const DomineeringState& state, const unsigned depth_limit);
 
     /**
-     * Searches under the given node.
-     * This method populates the `best_moves' vector, so that the calling
-     * method can look that up to find what the best move is for a certain
-     * depth.
+     * Searches with iterative deepening: depth 1, 2, 3, ... until the time
+     * runs out, a win or a loss is proven, or the game cannot go any deeper.
+     * The best move of each iteration is searched first in the next one, and
+     * the transposition table carries the limits found along the way.
+     * An iteration that runs out of time is thrown away; the result comes
+     * from the deepest iteration that completed. If the state is the one
+     * that was pondered, the search goes on from where pondering stopped.
      *
-     * \param[in] base the node to search under.
+     * \param[in] state current state of the game configuration.
      *
-     * \param[in] ab the alpha and beta values. Passed by value.
+     * \param[in] budget how long the search should take. No new iteration
+     *                   is started if it is not expected to finish within
+     *                   this time.
      *
-     * \param[in] state current state of the game.
+     * \param[in] hard_limit the search is stopped at this time no matter
+     *                       what.
      *
-     * \param[in] depth_limit the maximum depth to go down.
+     * \return the node that represents the best move to make.
      */
-    void search_under(const Node& base,
-                      AlphaBeta ab,
-                      const DomineeringState& state,
-                      const unsigned depth_limit);
+    Node iterative_search(const DomineeringState& state,
+                          const float budget,
+                          const float hard_limit);
+
+    /**
+     * Same as above, where the budget and hard limit come from the game
+     * clock (see Timer).
+     *
+     * \param[in] state current state of the game configuration.
+     *
+     * \return the node that represents the best move to make.
+     */
+    Node iterative_search(const DomineeringState& state);
+
+    /**
+     * Iterative deepening without a time limit, up to the given depth.
+     *
+     * \param[in] state current state of the game configuration.
+     *
+     * \param[in] depth_limit the depth of the last iteration.
+     *
+     * \return the node that represents the best move to make.
+     */
+    Node iterative_search(const DomineeringState& state,
+                          const unsigned depth_limit);
+
+    /**
+     * Starts searching, in the background, the position the game will most
+     * likely be in on our next turn: after `best' and the reply the last
+     * search expected to it. Does nothing if there is no such reply.
+     *
+     * \param[in] state the state the last search was run on.
+     *
+     * \param[in] best the move we are playing in `state'.
+     */
+    void start_pondering(const DomineeringState& state, const Node& best);
+
+    /**
+     * Stops pondering and waits for the thread to finish. What it found is
+     * kept for the next search.
+     */
+    void stop_pondering();
 
     /**
      * Given a state (i.e. the current board), this method evaluates and gives
@@ -107,9 +212,298 @@ public:
      */
     void cleanup();
 
+    /**
+     * Starts the clock of a new game.
+     *
+     * \param[in] game_time the total time we have for the game (GAMETIME).
+     *
+     * \param[in] move_time the longest a single move may take (MOVETIME).
+     */
+    void new_game(const float game_time, const float move_time);
+
+    /**
+     * Tells the clock that a move was played without searching, e.g. from
+     * the opening book.
+     */
+    void skip_search();
+
+    /**
+     * Corrects the clock with the time the server charged for our last move.
+     *
+     * \param[in] secs the time reported by the server.
+     */
+    void server_time(const double secs);
+
     float get_time_left() const { return timer.get_time_left(); }
 
+    /**
+     * Changes the number of search threads (see Settings::threads).
+     *
+     * \param[in] threads the number of threads, at least 1.
+     */
+    void set_threads(const unsigned threads);
+
+    /**
+     * Changes how the threads share the work.
+     *
+     * \param[in] parallel Lazy SMP or YBWC.
+     */
+    void set_parallel(const Parallel parallel);
+
+    /**
+     * Changes the search algorithm.
+     *
+     * \param[in] algorithm alpha-beta, PVS or MTD(f).
+     */
+    void set_algorithm(const Algorithm algorithm);
+
+    /**
+     * Memory-maps the tablebase of region values made by tools/tablebase.
+     *
+     * \param[in] path the tablebase file.
+     *
+     * \return false if there is no valid tablebase at `path'. Regions are
+     *         then solved as they come up.
+     */
+    bool load_tablebase(const std::string& path);
+
+    /**
+     * Writes a snapshot of the transposition table, to be read back by
+     * load_table in a later run.
+     *
+     * \param[in] path the file to write.
+     *
+     * \return false if the file could not be written.
+     */
+    bool save_table(const std::string& path);
+
+    /**
+     * Memory-maps a snapshot written by save_table and copies it into the
+     * transposition table. A snapshot of a table of another size is
+     * rehashed into this one.
+     *
+     * \param[in] path the snapshot file.
+     *
+     * \return false if there is no valid snapshot at `path' (wrong version,
+     *         another board size, truncated, or a checksum that does not
+     *         match). The table is empty then.
+     */
+    bool load_table(const std::string& path);
+
+    /**
+     * Reports every completed iteration of an iterative search: one line
+     * with the depth, the score for the side to move, the nodes and time
+     * so far, the nodes per second and the principal variation, e.g.
+     *
+     *     search depth 5 score 3 nodes 4820 time 0.01 nps 482000 pv 1,0h 2,3v
+     *
+     * Moves are written as the row and column of the anchor cell, followed
+     * by h or v for the orientation. Lines of a pondering search start
+     * with "ponder" instead of "search".
+     *
+     * \param[in] out where to write, nullptr to report nothing (the
+     *                default).
+     */
+    void set_report(std::ostream* out);
+
+    /**
+     * Turns solving regions on or off (see Settings::regions).
+     *
+     * \param[in] regions true to solve regions.
+     */
+    void set_regions(const bool regions);
+
+    /**
+     * Changes how leaves are evaluated (see Settings::kernels): from
+     * scratch with the SSE2 or AVX2 kernels, or with the counts kept up to
+     * date move by move for SCALAR. Both give the same scores.
+     *
+     * \param[in] isa the version of the kernels; must be supported by the
+     *                CPU.
+     */
+    void set_kernels(const BoardKernels::Isa isa);
+
+    /**
+     * \return the number of nodes all threads visited in the last search.
+     */
+    unsigned long get_nodes() const { return nodes_searched; }
+
+    /**
+     * \return the depth of the last completed iteration of the last
+     *         iterative search.
+     */
+    unsigned get_depth() const { return last_result.depth; }
+
 private:
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * The clock is looked at once every this many nodes (plus one).
+     */
+    static const unsigned long CLOCK_CHECK_MASK = 1023;
+
+    /**
+     * YBWC only splits nodes with at least this many plies left under them.
+     * Smaller trees are not worth the locking.
+     */
+    static const unsigned SPLIT_DEPTH = 3;
+
+    /**
+     * Regions are looked for once no more than this many cells are empty.
+     * With more, the board is almost always one big region.
+     */
+    static const unsigned REGION_EMPTIES = 36;
+
+    /**
+     * What a search thread knows about one node on its path. The frame of
+     * the node at ply p is worker.frames[p], filled in by the search of the
+     * node and read by its parent. Plain data, so the frames of a thread
+     * are one small block of memory.
+     */
+    struct Frame {
+        /* Best move of the node; none at a leaf, at a node cut by the table
+         * and at a node whose regions were solved */
+        Move move;
+        /* Score of the node, for HOME */
+        Evaluator::score_t score;
+    };
+
+    /**
+     * What an iterative deepening search came up with.
+     */
+    struct Result {
+        Result();
+
+        /* The principal variation: the move to play, then the reply the
+         * search expects to it, and so on. Empty if the root has no
+         * moves. */
+        std::vector<Move> pv;
+        /* Score of the root, for HOME */
+        Evaluator::score_t score;
+        /* The iteration the result comes from, 0 if there is none */
+        unsigned depth;
+    };
+
+    /**
+     * The children of a node that are left after its first child, up for
+     * grabs by any thread (YBWC). Lives on the stack of the thread that owns
+     * the node.
+     */
+    struct SplitPoint {
+        SplitPoint(SplitPoint* parent,
+                   const unsigned ply,
+                   const AlphaBeta& ab,
+                   const DomineeringState& state,
+                   const IncrementalEvaluator& eval,
+                   const MoveStack::move_t* children,
+                   const unsigned count,
+                   const unsigned depth_limit,
+                   const Frame& best);
+
+        /* The split point the owner was working under, if any */
+        SplitPoint* const parent;
+        /* Ply of the node that is split */
+        const unsigned ply;
+        /* The state at the node */
+        const DomineeringState state;
+        /* Its features, for the threads that join */
+        const IncrementalEvaluator eval;
+        /* The team to move there */
+        const Who team;
+        /* In the owner's move stack, which keeps them while it waits */
+        const MoveStack::move_t* children;
+        const unsigned count;
+        const unsigned depth_limit;
+
+        std::mutex mutex;
+        /* Signalled when `active' drops to 0 */
+        std::condition_variable done;
+
+        /* Guarded by `mutex' */
+        AlphaBeta ab;
+        Frame best;
+        /* Next child to hand out */
+        std::size_t next;
+        /* Number of threads other than the owner searching a child */
+        unsigned active;
+        /* A thread ran out of time; the result is incomplete */
+        bool aborted;
+        /* Principal variation under the best child, copied from the
+         * thread that searched it */
+        std::vector<Move> line;
+
+        /* Set on a cutoff; everything below is not needed anymore */
+        std::atomic<bool> stopped;
+    };
+
+    /**
+     * Split points of one thread, oldest first. The owner pushes and pops
+     * at the back; other threads steal from the front, where the biggest
+     * trees are.
+     */
+    struct SplitQueue {
+        std::mutex mutex;
+        std::deque<SplitPoint*> splits;
+    };
+
+    /**
+     * Everything a search thread changes while it searches. Each thread has
+     * its own.
+     */
+    struct Worker {
+        Worker(const unsigned id,
+               const DomineeringState& state,
+               const bool incremental,
+               RegionSolver* solver);
+
+        /* 0 for the main thread */
+        unsigned id;
+
+        /* Children are tapped onto and untapped from this copy */
+        DomineeringState state;
+
+        /**
+         * Features of the state children are tapped onto: `state', or the
+         * copy of a split point's state while helping with it. Keeps
+         * nothing unless the searcher evaluates incrementally.
+         */
+        IncrementalEvaluator eval;
+
+        /* One frame per ply of the current path */
+        std::vector<Frame> frames;
+
+        /* Number of nodes visited since the search started */
+        unsigned long nodes;
+
+        /**
+         * Set once the deadline has passed or the thread was told to stop.
+         * The results of the iteration are incomplete from then on.
+         */
+        bool aborted;
+
+        /* Deepest iteration this thread completed */
+        Result completed;
+
+        /* The split point whose child is being searched (YBWC) */
+        SplitPoint* split;
+
+        /* Owned by the searcher, so that it remembers across searches */
+        RegionSolver* solver;
+
+        /* Killers and history, kept from one iteration to the next; workers
+         * are made afresh for every search (see make_workers) */
+        MoveOrdering ordering;
+
+        /* Moves of the nodes on the current path, one frame per ply */
+        MoveStack moves;
+
+        /* Principal variation of every node on the current path */
+        PrincipalVariation pv;
+
+        /* Number of plies of the current path that follow previous_pv */
+        unsigned on_pv;
+    };
+
     Timer timer;
     /**
      * The root of the search tree.
@@ -117,29 +511,78 @@ private:
     Node root;
 
     /**
-     * A vector that contains the best moves for a certain depth.
-     * For example, best_moves[1] contains the best move that can be executed
-     * at depth 1.
+     * Number of threads that search at the same time, the main one included.
      */
-    std::vector<Node> best_moves;
+    unsigned threads;
 
     /**
-     * A vectors of Nodes that will potentially be our next move.
-     * The idea is to reorder the Nodes in each vector so that the Nodes that
-     * can potentially maximize pruning will come towards the front of the
-     * list.
-     *
-     * Key: the state. Compared against the actual move that our opponent has
-     *      made, and use the appropriate set of children.
-     * Val: the possible children nodes, ordered by preference.
+     * How the threads share the work.
+     */
+    Parallel parallel;
+
+    /**
+     * How each thread searches.
+     */
+    Algorithm algorithm;
+
+    /**
+     * Whether regions are solved.
+     */
+    bool regions;
+
+    /**
+     * Evaluates leaves, unless the workers keep the counts up to date (see
+     * incremental_eval).
+     */
+    BoardKernels kernels;
+
+    /**
+     * One region solver per thread. Kept from one search to the next, since
+     * the same regions keep showing up.
+     */
+    std::vector<std::unique_ptr<RegionSolver>> solvers;
+
+    /**
+     * Values of region shapes solved offline, shared by the solvers.
+     */
+    Tablebase tablebase;
+
+    /**
+     * Tells the helper threads to drop what they are doing.
+     */
+    std::atomic<bool> stop{false};
+
+    /**
+     * One queue of split points per thread, used by YBWC.
+     */
+    std::unique_ptr<SplitQueue[]> split_queues;
+
+    /**
+     * Thread that ponders during the opponent's turn.
+     */
+    std::thread ponder_thread;
+
+    /**
+     * Tells the ponder thread to stop.
+     */
+    std::atomic<bool> ponder_stop{false};
+
+    /**
+     * Key of the position that was pondered, and what was found there.
+     * Only read once the ponder thread has been joined.
      */
-    std::unordered_map<DomineeringState, std::vector<Node>> ordered_moves;
-    void move_order(Who team);
+    TranspositionTable::key_t ponder_key = 0;
+    Result ponder_result;
 
     /**
-     * Thread that is spawned to do move ordering during the opponents turn.
+     * Result of the last search, where pondering starts from.
      */
-    std::thread move_thread;
+    Result last_result;
+
+    /**
+     * Where every completed iteration is reported, if anywhere.
+     */
+    std::ostream* report = nullptr;
 
     /**
      * Transposition table that is used to find duplicates in board
@@ -147,49 +590,410 @@ private:
      */
     TranspositionTable tp_table;
 
-    Who last_team = Who::HOME;
+    /**
+     * When the current search has to stop.
+     */
+    clock::time_point deadline;
 
     /**
-     * Expands the given node for the next possible placement.
+     * Number of nodes visited by all threads in the last search.
+     */
+    unsigned long nodes_searched = 0;
+
+    /**
+     * Principal variation of the previous iteration. Its moves are searched
+     * first as long as the path follows it.
+     */
+    std::vector<Move> previous_pv;
+
+    /**
+     * Housekeeping done before a search: aging the transposition table.
+     */
+    void start_search();
+
+    /**
+     * Iterative deepening shared by the public searches.
+     *
+     * \param[in] state the state at the root.
+     *
+     * \param[in] depth_limit the depth of the last iteration.
      *
-     * \param[in] base the node to expand.
+     * \param[in] budget see iterative_search.
      *
-     * \param[in] current_state the state of the current game. Children are
-     *                          expanded by placing the base's team's
-     *                          dominoes onto current_state and checking if
-     *                          that is a valid move or not.
+     * \param[in] stop_at when the search must stop.
      *
-     * \return a vector of the expanded nodes. Note that the team of the nodes
-     *         is the opposite of the base.
+     * \param[in] resume what an earlier search of the same state found.
+     *                   Iterations start after resume.depth.
+     *
+     * \param[in] pondering true if called by the ponder thread, for the
+     *                      report.
+     *
+     * \return the deepest completed iteration. Also kept in last_result.
      */
-    std::vector<Node> expand(const Node& base,
-                             const DomineeringState& current_state);
+    Result deepen(const DomineeringState& state,
+                  const unsigned depth_limit,
+                  const float budget,
+                  const clock::time_point stop_at,
+                  const Result& resume = Result(),
+                  const bool pondering = false);
 
     /**
-     * Simulates the placing of a domino (i.e. move).
-     * This is done by placing changing the grids on the board pointed by the
-     * node to whatever team the node belongs to. Searcher::untap should be
-     * called to undo this action.
+     * Writes a line about a completed iteration to `report' (see
+     * set_report).
      *
-     * \param[in] node the node that modified the state.
+     * \param[in] result the iteration.
      *
-     * \param[out] state the state to be undone.
+     * \param[in] state the state at the root.
+     *
+     * \param[in] seconds the time since the search started.
+     *
+     * \param[in] pondering true if the search is pondering.
+     */
+    void report_iteration(const Result& result,
+                          const DomineeringState& state,
+                          const double seconds,
+                          const bool pondering) const;
+
+    /**
+     * Runs on the ponder thread until it is stopped or the search is done.
+     *
+     * \param[in] state the position to ponder.
+     */
+    void ponder(const DomineeringState state);
+
+    /**
+     * \return the node of the move a search came up with, for the public
+     *         interface.
+     *
+     * \param[in] result what the search found.
+     *
+     * \param[in] state the state at the root.
+     */
+    Node to_node(const Result& result, const DomineeringState& state) const;
+
+    /**
+     * \return one worker per thread, searching from the given state.
+     */
+    std::vector<Worker> make_workers(const DomineeringState& state);
+
+    /**
+     * \return true if the workers keep the features up to date as they tap
+     *         moves, rather than leaves being evaluated from scratch by the
+     *         kernels. Only the scalar kernels are slower than that.
+     */
+    bool incremental_eval(const DomineeringState& state) const;
+
+    /**
+     * \return the score of a leaf, as evaluate would give it.
+     */
+    Evaluator::score_t leaf_score(const Worker& worker,
+                                  const DomineeringState& state) const;
+
+    /**
+     * Searches to the given depth on all threads. Returns when the main
+     * thread is done; the helpers are stopped then.
+     *
+     * \param[in,out] workers the threads' contexts. workers[0] is searched
+     *                        on the calling thread.
+     *
+     * \param[in] depth_limit the maximum depth for the main thread.
+     */
+    void search_iteration(std::vector<Worker>& workers,
+                          const unsigned depth_limit);
+
+    /**
+     * Runs one full search from the root down to the given depth. The result
+     * is in worker.completed unless `worker.aborted' is set afterwards.
+     *
+     * \param[in,out] worker the thread's context.
+     *
+     * \param[in] depth_limit the maximum depth to search.
+     */
+    void search_to_depth(Worker& worker, const unsigned depth_limit);
+
+    /**
+     * MTD(f) from the root: zero-window calls to search_under, each of
+     * which tells whether the score is above or below a guess, until the
+     * lower and upper limits meet. The first guess is the score of the
+     * worker's previous iteration. Every pass reuses the limits the earlier
+     * ones left in the transposition table.
+     * Leaves the best root move in worker.frames[0] like search_under.
+     *
+     * \param[in,out] worker the thread's context.
+     *
+     * \param[in] depth_limit the maximum depth to search.
+     */
+    void search_mtdf(Worker& worker, const unsigned depth_limit);
+
+    /**
+     * Searches under the node at the given ply, whose state is `state'.
+     * The best move and the score end up in worker.frames[ply], where the
+     * parent looks them up.
+     *
+     * \param[in,out] worker the thread's context. Children are tapped onto
+     *                       its state and untapped again, so the state is
+     *                       unchanged when this method returns.
+     *
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \param[in] ab the alpha and beta values. Passed by value.
+     *
+     * \param[in] depth_limit the maximum depth to go down.
+     */
+    void search_under(Worker& worker,
+                      const unsigned ply,
+                      AlphaBeta ab,
+                      DomineeringState& state,
+                      const unsigned depth_limit);
+
+    /**
+     * Principal Variation Search under the given node, in negamax form:
+     * scores are seen from the side to move, so there is no HOME and AWAY
+     * case. The first child is searched with the full window, the others
+     * with a zero window that only tells whether they beat the best one so
+     * far; a child that does is searched again with the full window.
+     * Fills worker.frames like search_under, with scores for HOME.
+     *
+     * \param[in,out] worker the thread's context. The state is unchanged
+     *                       when this method returns.
+     *
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \param[in] alpha the score the side to move already has elsewhere.
+     *
+     * \param[in] beta the score the other team already has elsewhere, seen
+     *                 from the side to move.
+     *
+     * \param[in] depth_limit the maximum depth to go down.
+     *
+     * \return the score of the node for the side to move. Meaningless if
+     *         the worker was aborted or cut off.
      */
-    void tap(const Node& node, DomineeringState& state);
+    Evaluator::score_t search_pvs(Worker& worker,
+                                  const unsigned ply,
+                                  Evaluator::score_t alpha,
+                                  const Evaluator::score_t beta,
+                                  DomineeringState& state,
+                                  const unsigned depth_limit);
+
+    /**
+     * Puts the best root move of the previous iteration first, and rotates
+     * the others by the worker's id so that threads start apart.
+     *
+     * \param[in] worker the thread's context.
+     *
+     * \param[in,out] children the moves of the root.
+     *
+     * \param[in] count the number of moves.
+     */
+    void order_root(const Worker& worker,
+                    MoveStack::move_t* children,
+                    const unsigned count) const;
+
+    /**
+     * Solves the regions of the board once few enough cells are empty.
+     *
+     * \param[in,out] worker the thread's context. If the winner is known,
+     *                       worker.frames[ply] is set to it.
+     *
+     * \param[in] ply the depth of the node being searched. Never the root.
+     *
+     * \param[in] state the state at the node.
+     *
+     * \param[in,out] moves the moves of the side to move. Moves in regions
+     *                      that add up to 0 are taken out.
+     *
+     * \return true if the winner is known.
+     */
+    bool solve_regions(Worker& worker,
+                       const unsigned ply,
+                       const DomineeringState& state,
+                       Bitboard& moves);
+
+    /**
+     * \return true if a split point the worker is under has been cut off,
+     *         so that its search is not needed anymore.
+     */
+    bool cut_off(const Worker& worker) const;
+
+    /**
+     * Searches children[1..] of a node together with any thread that is
+     * idle, and waits for all of them to finish.
+     *
+     * \param[in,out] worker the owner's context.
+     *
+     * \param[in] ply the depth of the node that is split.
+     *
+     * \param[in,out] ab the window, updated with the children's scores.
+     *
+     * \param[in,out] state the state at the node.
+     *
+     * \param[in] children the moves of the node, in the owner's move stack;
+     *                     the first one has been searched.
+     *
+     * \param[in] count the number of moves.
+     *
+     * \param[in] depth_limit the maximum depth to go down.
+     *
+     * \param[in,out] best the best child so far, updated.
+     *
+     * \return true if there was a cutoff.
+     */
+    bool split(Worker& worker,
+               const unsigned ply,
+               AlphaBeta& ab,
+               DomineeringState& state,
+               const MoveStack::move_t* children,
+               const unsigned count,
+               const unsigned depth_limit,
+               Frame& best);
+
+    /**
+     * Searches children of the split point until there are none left.
+     *
+     * \param[in,out] worker the context of the thread.
+     *
+     * \param[in,out] sp the split point.
+     *
+     * \param[in,out] state the state at the split point. It is unchanged
+     *                     when this method returns.
+     *
+     * \param[in] index the child to start with. Already taken from `sp'.
+     */
+    void search_split(Worker& worker,
+                      SplitPoint& sp,
+                      DomineeringState& state,
+                      std::size_t index);
+
+    /**
+     * Looks for a split point of another thread with children left, and
+     * helps with it.
+     *
+     * \return true if there was something to do.
+     */
+    bool steal(Worker& worker);
+
+    /**
+     * What the helper threads do in YBWC: steal work until told to stop.
+     *
+     * \param[in,out] worker the context of the thread.
+     *
+     * \param[in] depth_limit the depth of the iteration.
+     */
+    void help(Worker& worker, const unsigned depth_limit);
+
+    /**
+     * Puts the moves of a node in the order they should be searched in.
+     *
+     * \param[in] worker the thread's context, whose move ordering is used.
+     *
+     * \param[in] ply the depth of the node in the tree.
+     *
+     * \param[in] team the team to move at the node.
+     *
+     * \param[in] moves anchor cells of the moves.
+     *
+     * \param[in] entry what the transposition table has on the node. Its
+     *                  best move, if any, is searched first if the score is
+     *                  exact, right after the killers otherwise. On the
+     *                  path of the previous principal variation, its move
+     *                  comes first instead.
+     *
+     * \param[out] children the moves, best first. The frame of the ply in
+     *                      the worker's move stack.
+     *
+     * \return the number of moves.
+     */
+    unsigned order_moves(const Worker& worker,
+                         const unsigned ply,
+                         const Who team,
+                         const Bitboard& moves,
+                         const TranspositionTable::Entry& entry,
+                         MoveStack::move_t* children) const;
+
+    /**
+     * \return true if the path the worker is on follows the previous
+     *         principal variation down to ply, and `move' goes on with it.
+     */
+    bool follows_pv(const Worker& worker,
+                    const unsigned ply,
+                    const Move move) const;
+
+    /**
+     * Simulates the placing of a domino (i.e. move) and hands the turn over
+     * to the other team. Searcher::untap should be called to undo this
+     * action.
+     *
+     * \param[in] move the move to make.
+     *
+     * \param[out] state the state to be changed.
+     *
+     * \param[out] eval the features of the state, changed along with it.
+     */
+    static void tap(const Move move,
+                    DomineeringState& state,
+                    IncrementalEvaluator& eval);
 
     /**
      * Rewinds the state to before tapping by clearing the place in the board
      * where the domino was placed.
      *
-     * \param[in] node the node that modified the state.
+     * \param[in] move the move that was made.
      *
      * \param[out] state the state to be undone.
+     *
+     * \param[out] eval the features of the state, undone along with it.
      */
-    void untap(const Node& node, DomineeringState& state);
+    static void untap(const Move move,
+                      DomineeringState& state,
+                      IncrementalEvaluator& eval);
 };
 
-inline void Searcher::set_root(const Node& root) {
-    this->root = root;
+inline bool Searcher::follows_pv(const Worker& worker,
+        const unsigned ply,
+        const Move move) const {
+    return worker.on_pv == ply && ply < previous_pv.size()
+        && previous_pv[ply] == move;
+}
+
+inline void Searcher::set_threads(const unsigned threads) {
+    this->threads = std::max(1u, threads);
+}
+
+inline void Searcher::set_parallel(const Parallel parallel) {
+    this->parallel = parallel;
+}
+
+inline void Searcher::set_algorithm(const Algorithm algorithm) {
+    this->algorithm = algorithm;
+}
+
+inline void Searcher::set_report(std::ostream* out) {
+    report = out;
+}
+
+inline void Searcher::set_regions(const bool regions) {
+    this->regions = regions;
+}
+
+inline void Searcher::set_kernels(const BoardKernels::Isa isa) {
+    kernels = BoardKernels(isa);
+}
+
+inline bool Searcher::incremental_eval(
+        const DomineeringState& state) const {
+    return kernels.isa() == BoardKernels::Isa::SCALAR
+        && static_cast<unsigned>(state.ROWS)
+            <= IncrementalEvaluator::MAX_LINE
+        && static_cast<unsigned>(state.COLS)
+            <= IncrementalEvaluator::MAX_LINE;
+}
+
+inline Evaluator::score_t Searcher::leaf_score(const Worker& worker,
+        const DomineeringState& state) const {
+    return worker.eval.active()
+        ? worker.eval.score()
+        : kernels.features(state).score();
 }
 
 #endif /* end of include guard */
@@ -0,0 +1,22 @@
+#include "Settings.h"
+
+Settings::Settings()
+    : params{std::string("config") + Params::separatorChar + "uccineers.txt"}
+{
+}
+
+const Settings& Settings::get() {
+    static const Settings settings;
+    return settings;
+}
+
+int Settings::int_value(const std::string& key, const int def) const {
+    return params.isDefined(key) ? params.intValue(key) : def;
+}
+
+std::string Settings::string_value(const std::string& key,
+        const std::string& def) const {
+    return params.isDefined(key) ? params.stringValue(key) : def;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,137 @@
+#ifndef SETTINGS_H_
+#define SETTINGS_H_
+
+#include "Params.h"
+
+#include <algorithm>
+#include <string>
+#include <thread>
+
+/**
+ * Tunable settings of the engine, read from config/uccineers.txt.
+ * Every key is optional. A missing file or key falls back to the default
+ * given next to the accessor.
+ */
+class Settings {
+public:
+    /**
+     * \return the settings shared by the whole program.
+     */
+    static const Settings& get();
+
+    /**
+     * TT_MB: memory budget of the transposition table in megabytes.
+     * Default: 500.
+     */
+    unsigned tt_megabytes() const;
+
+    /**
+     * THREADS: number of search threads. 0 uses one per hardware thread.
+     * Default: 0.
+     */
+    unsigned threads() const;
+
+    /**
+     * PARALLEL: how the search threads share the work, LAZY (Lazy SMP) or
+     * YBWC (Young Brothers Wait).
+     * Default: LAZY.
+     */
+    std::string parallel() const;
+
+    /**
+     * REGIONS: 1 to solve small regions of the board exactly with
+     * combinatorial game theory during the search, 0 to search them like
+     * the rest of the board.
+     * Default: 1.
+     */
+    bool regions() const;
+
+    /**
+     * SEARCH: the search algorithm, ALPHABETA (alpha-beta over HOME and AWAY
+     * scores), PVS (Principal Variation Search in negamax form) or MTDF
+     * (MTD(f): zero-window alpha-beta searches closing in on the score).
+     * Default: ALPHABETA.
+     */
+    std::string search() const;
+
+    /**
+     * TT_SAVE: 1 to keep the transposition table between runs (see
+     * TranspositionTable::save), 0 to start from an empty table every time.
+     * Default: 1.
+     */
+    bool save_table() const;
+
+    /**
+     * REPORT: 1 to write a line about every completed search iteration to
+     * stderr (depth, score, nodes, speed and principal variation; see
+     * Searcher::set_report), 0 to stay quiet.
+     * Default: 1.
+     */
+    bool report() const;
+
+    /**
+     * KERNELS: which version of BoardKernels evaluates positions, SCALAR,
+     * SSE2 or AVX2, or AUTO for the fastest one the CPU supports. A version
+     * the CPU does not support falls back to AUTO. With SCALAR the counts
+     * are kept up to date move by move instead (see IncrementalEvaluator).
+     * Default: AUTO.
+     */
+    std::string kernels() const;
+
+private:
+    Settings();
+
+    /**
+     * \return the integer value of the key, or def if it is not defined.
+     */
+    int int_value(const std::string& key, const int def) const;
+
+    /**
+     * \return the value of the key in upper case, or def if it is not
+     *         defined.
+     */
+    std::string string_value(const std::string& key,
+                             const std::string& def) const;
+
+    Params params;
+};
+
+inline unsigned Settings::tt_megabytes() const {
+    return int_value("TT_MB", 500);
+}
+
+inline unsigned Settings::threads() const {
+    const int threads = int_value("THREADS", 0);
+    if (threads > 0) {
+        return threads;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+inline std::string Settings::parallel() const {
+    return string_value("PARALLEL", "LAZY");
+}
+
+inline bool Settings::regions() const {
+    return int_value("REGIONS", 1) != 0;
+}
+
+inline std::string Settings::search() const {
+    return string_value("SEARCH", "ALPHABETA");
+}
+
+inline bool Settings::save_table() const {
+    return int_value("TT_SAVE", 1) != 0;
+}
+
+inline bool Settings::report() const {
+    return int_value("REPORT", 1) != 0;
+}
+
+inline std::string Settings::kernels() const {
+    return string_value("KERNELS", "AUTO");
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
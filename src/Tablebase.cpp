@@ -0,0 +1,147 @@
+#include "Tablebase.h"
+#include "Params.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+const Tablebase::form_t Tablebase::NOT_FOUND;
+const unsigned Tablebase::KEY_BYTES;
+const std::uint32_t Tablebase::VERSION;
+const char Tablebase::MAGIC[8] = {'U', 'C', 'C', 'R', 'E', 'G', 'N', '\0'};
+
+namespace {
+    /**
+     * \return the key padded to KEY_BYTES.
+     */
+    std::string padded(const std::string& key) {
+        std::string k{key, 0, Tablebase::KEY_BYTES};
+        k.resize(Tablebase::KEY_BYTES, '\0');
+        return k;
+    }
+} // namespace
+
+/* Constructors and destructor {{{ */
+Tablebase::Tablebase()
+    : header{nullptr}
+    , begin{nullptr}
+    , split{nullptr}
+    , option_list{nullptr}
+    , records{nullptr}
+{
+}
+
+Tablebase::~Tablebase() {
+    close();
+}
+/* }}} */
+
+std::string Tablebase::default_path() {
+    return std::string("config") + Params::separatorChar + "regions.tb";
+}
+
+bool Tablebase::open(const std::string& path) {
+    close();
+    if (!file.open(path) || file.size() < sizeof(Header)) {
+        close();
+        return false;
+    }
+
+    const Header* h = static_cast<const Header*>(file.data());
+    const std::size_t expected = sizeof(Header)
+        + sizeof(std::uint32_t) * (2 * std::size_t{h->forms} + 1)
+        + sizeof(form_t) * std::size_t{h->options}
+        + sizeof(Record) * std::size_t{h->records};
+    if (std::memcmp(h->magic, MAGIC, sizeof(MAGIC)) != 0
+            || h->version != VERSION
+            || expected != file.size()) {
+        close();
+        return false;
+    }
+
+    const char* p = static_cast<const char*>(file.data()) + sizeof(Header);
+    begin = reinterpret_cast<const std::uint32_t*>(p);
+    split = begin + h->forms + 1;
+    option_list = split + h->forms;
+    records = reinterpret_cast<const Record*>(option_list + h->options);
+    header = h;
+    return true;
+}
+
+void Tablebase::close() {
+    file.close();
+    header = nullptr;
+    begin = split = option_list = nullptr;
+    records = nullptr;
+}
+
+Tablebase::form_t Tablebase::find(const std::string& key) const {
+    if (header == nullptr) {
+        return NOT_FOUND;
+    }
+    const std::string k = padded(key);
+    const Record* end = records + header->records;
+    const Record* found = std::lower_bound(records, end, k,
+            [](const Record& r, const std::string& k) {
+                return std::memcmp(r.key, k.data(), KEY_BYTES) < 0;
+            });
+    if (found == end || std::memcmp(found->key, k.data(), KEY_BYTES) != 0) {
+        return NOT_FOUND;
+    }
+    return found->form;
+}
+
+void Tablebase::options(const form_t form,
+        std::vector<form_t>& left,
+        std::vector<form_t>& right) const {
+    left.assign(option_list + begin[form], option_list + split[form]);
+    right.assign(option_list + split[form], option_list + begin[form + 1]);
+}
+
+bool Tablebase::write(const std::string& path,
+        const std::vector<Form>& forms,
+        const std::vector<std::pair<std::string, form_t>>& shapes) {
+    std::vector<std::uint32_t> begins, splits;
+    std::vector<form_t> options;
+    for (const Form& form : forms) {
+        begins.push_back(options.size());
+        options.insert(options.end(), form.first.begin(), form.first.end());
+        splits.push_back(options.size());
+        options.insert(options.end(), form.second.begin(), form.second.end());
+    }
+    begins.push_back(options.size());
+
+    std::vector<Record> sorted;
+    for (const auto& shape : shapes) {
+        Record r;
+        std::memcpy(r.key, padded(shape.first).data(), KEY_BYTES);
+        r.padding = 0;
+        r.form = shape.second;
+        sorted.push_back(r);
+    }
+    std::sort(sorted.begin(), sorted.end(),
+            [](const Record& a, const Record& b) {
+                return std::memcmp(a.key, b.key, KEY_BYTES) < 0;
+            });
+
+    Header h;
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.forms = forms.size();
+    h.options = options.size();
+    h.records = sorted.size();
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    ofs.write(reinterpret_cast<const char*>(begins.data()),
+            sizeof(std::uint32_t) * begins.size());
+    ofs.write(reinterpret_cast<const char*>(splits.data()),
+            sizeof(std::uint32_t) * splits.size());
+    ofs.write(reinterpret_cast<const char*>(options.data()),
+            sizeof(form_t) * options.size());
+    ofs.write(reinterpret_cast<const char*>(sorted.data()),
+            sizeof(Record) * sorted.size());
+    return static_cast<bool>(ofs);
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
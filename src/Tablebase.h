@@ -0,0 +1,160 @@
+#ifndef TABLEBASE_H_
+#define TABLEBASE_H_
+
+#include "MappedFile.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * A read-only database of the values of small regions, made offline by
+ * tools/tablebase and memory-mapped at startup (see RegionSolver).
+ *
+ * The file holds the game values as a table of canonical forms, and one
+ * record per region shape that points into it. Shapes are stored under the
+ * key of RegionSolver::Shape, so mirror images share a record, and so do
+ * transposes (see RegionSolver::Shape::canonical) in files written since
+ * the solver shares them. Forms only refer to forms before them, so a form
+ * can be rebuilt from its options.
+ *
+ * Layout, in native byte order:
+ *
+ *     Header
+ *     std::uint32_t begin[forms + 1]   first option of every form
+ *     std::uint32_t split[forms]       first right option of every form
+ *     std::uint32_t options[...]       left, then right options
+ *     Record records[...]              sorted by key
+ *
+ * Nothing is parsed when the file is opened; lookups binary search the
+ * records in the mapped file.
+ */
+class Tablebase {
+public:
+    using form_t = std::uint32_t;
+
+    static const form_t NOT_FOUND = 0xffffffff;
+
+    /**
+     * Bytes of a shape key: rows, columns and 16 bits for each of up to 16
+     * rows. Shorter keys are padded with zeros.
+     */
+    static const unsigned KEY_BYTES = 34;
+
+    /**
+     * Changes whenever the layout of the file does.
+     */
+    static const std::uint32_t VERSION = 1;
+
+    /**
+     * A form to be written: its left and right options.
+     */
+    using Form = std::pair<std::vector<form_t>, std::vector<form_t>>;
+
+    Tablebase();
+
+    ~Tablebase();
+
+    Tablebase(const Tablebase&) = delete;
+    Tablebase& operator=(const Tablebase&) = delete;
+
+    /**
+     * \return where the tablebase is looked for: config/regions.tb.
+     */
+    static std::string default_path();
+
+    /**
+     * Maps the file into memory. A tablebase that was open before is
+     * closed first.
+     *
+     * \param[in] path the file made by tools/tablebase.
+     *
+     * \return false if the file is missing or is not a valid tablebase.
+     */
+    bool open(const std::string& path);
+
+    void close();
+
+    bool is_open() const;
+
+    /**
+     * \return the number of shapes.
+     */
+    std::size_t size() const;
+
+    /**
+     * \param[in] key the key of a normalized or canonical shape
+     *                (RegionSolver::Shape).
+     *
+     * \return the form of the shape's value, or NOT_FOUND.
+     */
+    form_t find(const std::string& key) const;
+
+    /**
+     * Reads the options of a form.
+     *
+     * \param[in] form a form returned by find, or an option of one.
+     *
+     * \param[out] left the left options.
+     *
+     * \param[out] right the right options.
+     */
+    void options(const form_t form,
+                 std::vector<form_t>& left,
+                 std::vector<form_t>& right) const;
+
+    /**
+     * Writes a tablebase.
+     *
+     * \param[in] path the file to write.
+     *
+     * \param[in] forms the forms. Options may only refer to earlier forms.
+     *
+     * \param[in] shapes shape keys and the forms of their values.
+     *
+     * \return false if the file could not be written.
+     */
+    static bool write(const std::string& path,
+            const std::vector<Form>& forms,
+            const std::vector<std::pair<std::string, form_t>>& shapes);
+
+private:
+    struct Header {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t forms;
+        std::uint32_t options;
+        std::uint32_t records;
+    };
+
+    struct Record {
+        unsigned char key[KEY_BYTES];
+        std::uint16_t padding;
+        form_t form;
+    };
+
+    static const char MAGIC[8];
+
+    MappedFile file;
+
+    /* Sections of the file */
+    const Header* header;
+    const std::uint32_t* begin;
+    const std::uint32_t* split;
+    const form_t* option_list;
+    const Record* records;
+};
+
+inline bool Tablebase::is_open() const {
+    return header != nullptr;
+}
+
+inline std::size_t Tablebase::size() const {
+    return header == nullptr ? 0 : header->records;
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
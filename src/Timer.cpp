@@ -1,5 +1,12 @@
 #include "Timer.h"
 
+#include <algorithm>
+
+constexpr double Timer::RESERVE;
+constexpr double Timer::MARGIN;
+constexpr double Timer::STRETCH;
+constexpr double Timer::SMOOTHING;
+
 void Timer::click() {
     if (t_start == -1 || (t_start != -1 && t_end != -1)) {
         gettimeofday(&t_dummy, NULL);
@@ -27,16 +34,58 @@ int Timer::get_moves_left() {
     return moves_left;
 }
 
+void Timer::set_moves_left(int m) {
+    moves_left = std::max(m, 1);
+}
+
 float Timer::get_move_time() {
-    return time_left / moves_left;
+    // Near the end of the clock, stop keeping a reserve and just play fast
+    double usable = time_left > RESERVE ? time_left - RESERVE
+        : time_left / 4;
+    // Every move also costs us the latency on top of the search itself
+    double share = usable / moves_left - latency;
+    return std::max(0.0, std::min<double>(share, get_hard_limit()));
+}
+
+float Timer::get_hard_limit() {
+    double limit = std::min(move_time, time_left) - latency - MARGIN;
+    double usable = time_left > RESERVE ? time_left - RESERVE
+        : time_left / 4;
+    limit = std::min(limit, STRETCH * usable / moves_left);
+    return std::max(0.0, limit);
+}
+
+void Timer::start_iterations() {
+    last_nodes = 0;
+    last_seconds = 0;
+}
+
+void Timer::record_iteration(unsigned long nodes, double seconds) {
+    // Nodes of iteration d over nodes of iteration d - 1. Iterations that
+    // are too small say more about overhead than about the tree.
+    if (last_nodes >= 64 && nodes > last_nodes) {
+        double ratio = static_cast<double>(nodes) / last_nodes;
+        branching_factor = (1 - SMOOTHING) * branching_factor
+            + SMOOTHING * ratio;
+    }
+    last_nodes = nodes;
+    last_seconds = seconds;
+}
+
+double Timer::predict_next_iteration() const {
+    return last_seconds * branching_factor;
+}
+
+float Timer::get_branching_factor() const {
+    return branching_factor;
 }
 
-int Timer::get_suggested_depth(const int b) {
-    int i;
-    for (i = 0; i < predicted_times[b].size(); i++) {
-        if (predicted_times[b][i] >= get_move_time()) {
-            break;
-        }
+void Timer::server_time(double secs) {
+    if (diff < 0) {
+        return;
     }
-    return i < predicted_times[b].size() ? i - 1 : predicted_times[b].back();
+    // click() charged our own measurement; charge what the server saw
+    time_left += diff - secs;
+    double sample = std::max(0.0, secs - diff);
+    latency = (1 - SMOOTHING) * latency + SMOOTHING * sample;
 }
@@ -5,6 +5,19 @@
 #include <cstddef>
 #include <vector>
 
+/**
+ * Keeps track of our game clock and decides how much of it a move may use.
+ *
+ * The clock starts at GAMETIME and no single move may take longer than
+ * MOVETIME. The time of a move is first measured locally with click() and
+ * then replaced by what the server says it charged us (server_time), which
+ * also teaches the timer how much latency to allow for.
+ *
+ * During a move, the searcher reports every completed iteration of iterative
+ * deepening. From the node counts the timer keeps an estimate of the
+ * effective branching factor, which predicts how long the next iteration
+ * would take.
+ */
 class Timer {
     timeval t_dummy;
     double t_start;
@@ -12,41 +25,87 @@ class Timer {
     double diff;
     double time_left;
     int moves_left;
-    std::vector<std::vector<float>> predicted_times;
+    /* No single move may take longer than this (MOVETIME) */
+    double move_time;
+    /* Time the server charges on top of our own measurement of a move */
+    double latency;
+    /* Effective branching factor, carried over from one move to the next */
+    double branching_factor;
+    /* Node count and seconds of the last completed iteration */
+    unsigned long last_nodes;
+    double last_seconds;
 
     public:
-    Timer() :
-        t_start(-1),
-        t_end(-1),
-        diff(-1),
-        time_left(-1),
-        moves_left(14)
-    {
-    }
-    Timer(float tl) :
-        t_start(-1),
-        t_end(-1),
-        diff(-1),
-        time_left(tl),
-        moves_left(14)
-    {
-    }
-    Timer(float tl, std::vector<std::vector<float>> pt) :
+    /* Seconds kept aside for the end of the game */
+    static constexpr double RESERVE = 20;
+    /* Never plan closer than this to a hard limit */
+    static constexpr double MARGIN = 0.1;
+    /* How far past its share of the clock a move may go if needed */
+    static constexpr double STRETCH = 3;
+    /* Weight of the newest sample in the running averages */
+    static constexpr double SMOOTHING = 0.3;
+
+    Timer() : Timer(240, 240) {}
+    Timer(float tl) : Timer(tl, tl) {}
+    Timer(float tl, float mt) :
         t_start(-1),
         t_end(-1),
         diff(-1),
         time_left(tl),
-        moves_left(14)
+        moves_left(14),
+        move_time(mt),
+        latency(0),
+        branching_factor(4),
+        last_nodes(0),
+        last_seconds(0)
     {
-        predicted_times = std::move(pt);
     }
     ~Timer() {}
     void click();
     float get_time();
     float get_time_left() const;
     int get_moves_left();
+    void set_moves_left(int m);
+
+    /**
+     * Share of the clock for the current move: what the search should aim
+     * for. Depends on the number of moves left (see set_moves_left).
+     */
     float get_move_time();
-    int get_suggested_depth(int b);
+
+    /**
+     * Time after which the current move must be played no matter what.
+     */
+    float get_hard_limit();
+
+    /**
+     * Called before the first iteration of a move.
+     */
+    void start_iterations();
+
+    /**
+     * Records a completed iteration and updates the branching factor.
+     *
+     * \param[in] nodes nodes searched by the iteration.
+     *
+     * \param[in] seconds time the iteration took.
+     */
+    void record_iteration(unsigned long nodes, double seconds);
+
+    /**
+     * \return how long the next iteration is expected to take.
+     */
+    double predict_next_iteration() const;
+
+    float get_branching_factor() const;
+
+    /**
+     * Corrects the clock with the time the server charged for our last move
+     * (the TIME message) and updates the latency estimate.
+     *
+     * \param[in] secs time reported by the server.
+     */
+    void server_time(double secs);
 };
 
 #endif
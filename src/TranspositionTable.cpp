@@ -1,46 +1,69 @@
 #include "TranspositionTable.h"
+#include "AlphaBeta.h"
+#include "Params.h"
+#include "Settings.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <vector>
 
 using TPT = TranspositionTable;
 using score_t = Evaluator::score_t;
 
+const unsigned TPT::BYTES_PER_MEGABYTE;
+const unsigned TPT::BUCKET_BYTES;
+const unsigned TPT::ENTRIES_PER_BUCKET;
+const unsigned TPT::PROVEN_DEPTH;
+const std::uint32_t TPT::SNAPSHOT_VERSION;
+const char TPT::SNAPSHOT_MAGIC[8] = {'U', 'C', 'C', 'T', 'T', '\0', '\0', '\0'};
+
 /* Constructors for TranspositionTable::Entry {{{ */
 TPT::Entry::Entry()
     : lower_limit{0}
     , upper_limit{0}
-    , nodes_searched{0}
+    , depth{0}
+    , move{}
 { }
 
 TPT::Entry::Entry(const score_t lower_limit,
                   const score_t upper_limit,
-                  const long unsigned nodes_searched)
+                  const unsigned depth,
+                  const Move move)
     : lower_limit{lower_limit}
     , upper_limit{upper_limit}
-    , nodes_searched{nodes_searched}
+    , depth{depth}
+    , move{move}
 { }
 
 TPT::Entry::Entry(const TPT::Entry& other)
     : lower_limit{other.lower_limit}
     , upper_limit{other.upper_limit}
-    , nodes_searched{other.nodes_searched}
+    , depth{other.depth}
+    , move{other.move}
 { }
 
 TPT::Entry::Entry(TPT::Entry&& other)
     : lower_limit{std::move(other.lower_limit)}
     , upper_limit{std::move(other.upper_limit)}
-    , nodes_searched{std::move(other.nodes_searched)}
+    , depth{std::move(other.depth)}
+    , move{std::move(other.move)}
 { }
 
 TPT::Entry& TPT::Entry::operator=(const Entry& other) {
     lower_limit = other.lower_limit;
     upper_limit = other.upper_limit;
-    nodes_searched = other.nodes_searched;
+    depth = other.depth;
+    move = other.move;
     return *this;
 }
 
 TPT::Entry& TPT::Entry::operator=(Entry&& other) {
     lower_limit = std::move(other.lower_limit);
     upper_limit = std::move(other.upper_limit);
-    nodes_searched = std::move(other.nodes_searched);
+    depth = std::move(other.depth);
+    move = std::move(other.move);
     return *this;
 }
 /* }}} */
@@ -48,169 +71,380 @@ TPT::Entry& TPT::Entry::operator=(Entry&& other) {
 /* Constructors, Destructor, and Assignment operator {{{ */
 // Default constructor
 TPT::TranspositionTable()
+    : TranspositionTable(Settings::get().tt_megabytes())
 { }
 
+TPT::TranspositionTable(const unsigned megabytes)
+    : buckets{nullptr}
+    , bucket_count{std::size_t{megabytes} * BYTES_PER_MEGABYTE / BUCKET_BYTES}
+    , age{1}
+{
+    // The bucket index is computed from 32 bits of the key
+    bucket_count = std::min<std::size_t>(bucket_count, std::size_t{1} << 32);
+    bucket_count = std::max<std::size_t>(bucket_count, 1);
+    allocate();
+    clear();
+}
+
 // Copy constructor
 TPT::TranspositionTable(const TPT& other)
-    : table{other.table}
-{ }
+    : buckets{nullptr}
+    , bucket_count{other.bucket_count}
+    , age{other.age}
+{
+    allocate();
+    std::memcpy(static_cast<void*>(buckets), other.buckets,
+            bucket_count * BUCKET_BYTES);
+}
 
 // Move constructor
 TPT::TranspositionTable(TPT&& other)
-    : table{std::move(other.table)}
-{ }
+    : buckets{other.buckets}
+    , bucket_count{other.bucket_count}
+    , age{other.age}
+{
+    other.buckets = nullptr;
+    other.bucket_count = 0;
+}
 
 // Destructor
-TPT::~TranspositionTable()
-{ }
+TPT::~TranspositionTable() {
+    std::free(buckets);
+}
 
 // Assignment operator
 TPT& TPT::operator=(const TPT& other) {
-    table = other.table;
+    if (this != &other) {
+        if (bucket_count != other.bucket_count) {
+            std::free(buckets);
+            bucket_count = other.bucket_count;
+            allocate();
+        }
+        std::memcpy(static_cast<void*>(buckets), other.buckets,
+            bucket_count * BUCKET_BYTES);
+        age = other.age;
+    }
     return *this;
 }
 
 TPT& TPT::operator=(TPT&& other) {
-    table = std::move(other.table);
+    std::swap(buckets, other.buckets);
+    std::swap(bucket_count, other.bucket_count);
+    std::swap(age, other.age);
     return *this;
 }
 /* }}} */
 
-std::pair<TPT::Entry, bool> TPT::check(const DomineeringState& state) {
-    DomineeringState state_copy{state};
+void TPT::clear() {
+    std::memset(static_cast<void*>(buckets), 0, bucket_count * BUCKET_BYTES);
+}
 
-    // Original position
-    auto it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
+std::pair<TPT::Entry, bool> TPT::check(const key_t key) {
+    Bucket& bucket = bucket_for(key);
+    for (Slot& slot : bucket.slots) {
+        const std::uint64_t data = load(slot, key);
+        if (data != 0) {
+            // Still useful: keep it for the next search
+            store(slot, key, (data & ~(std::uint64_t{0xff} << 40))
+                    | std::uint64_t{age} << 40);
+            return std::make_pair(unpack(data), true);
+        }
     }
 
-    flip_horizontal(state_copy);
-
-    // Horizontal
-    it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
-    }
+    // No match
+    return std::make_pair(Entry(), false);
+}
 
-    // Horizontal AND vertical
-    flip_vertical(state_copy);
-    it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
-    }
+std::pair<TPT::Entry, bool> TPT::check(const DomineeringState& state) {
+    unsigned symmetry;
+    std::pair<Entry, bool> result = check(state.getCanonicalKey(symmetry));
+    // Back from the canonical board
+    result.first.move = result.first.move.transform(symmetry, state.ROWS,
+            state.COLS);
+    return result;
+}
 
-    // Vertical
-    // Revert the horizontal flip
-    flip_horizontal(state_copy);
-    it = table.find(state);
-    if (it != table.end()) {
-        return std::make_pair(it->second, true);
-    }
+void TPT::insert(const key_t key,
+                 const score_t lower_limit,
+                 const score_t upper_limit,
+                 const unsigned depth,
+                 const Move move) {
+    // A win or a loss does not depend on how deep we looked
+    const bool proven = lower_limit == AlphaBeta::POS_INF
+        || upper_limit == AlphaBeta::NEG_INF;
+    const std::uint64_t data = pack(lower_limit, upper_limit,
+            proven ? PROVEN_DEPTH : std::min(depth, PROVEN_DEPTH),
+            age, move);
 
-    // No match
-    return std::make_pair(Entry(), false);
+    place(key, data);
 }
 
-void TPT::shrink() {
-    // Key-Value type
-    using k_v_t = std::pair<
-        decltype(table)::key_type,
-        decltype(table)::mapped_type
-    >;
-    // Move all entries into a vector and sort
-    std::vector<k_v_t> tmp;
-    tmp.resize(table.size());
-    std::move(table.begin(), table.end(), tmp.begin());
-    // Sort so that the largest nodes_searched comes first
-    std::sort(tmp.begin(), tmp.end(), [](const k_v_t& a, const k_v_t& b) {
-              return a.second.nodes_searched > b.second.nodes_searched;
-              });
-    // Shrink and destroy entries
-    tmp.resize(TP_MAX * SHRINK_RATE);
-    // Them move them back to the table
-    for (auto&& p : std::move(tmp)) {
-        table.insert(p);
+void TPT::insert(const key_t key,
+                 const score_t score,
+                 const Bound bound,
+                 const unsigned depth,
+                 const Move move) {
+    switch (bound) {
+        case Bound::EXACT:
+            insert(key, score, score, depth, move);
+            break;
+        case Bound::LOWER:
+            insert(key, score, AlphaBeta::POS_INF, depth, move);
+            break;
+        case Bound::UPPER:
+            insert(key, AlphaBeta::NEG_INF, score, depth, move);
+            break;
     }
 }
 
 void TPT::insert(const DomineeringState& state,
                  const score_t lower_limit,
                  const score_t upper_limit,
-                 const long unsigned nodes_searched) {
-    // Check table size first
-    if (table.size() > TPT::TP_MAX && TPT::TP_MAX != 0) {
-        shrink();
+                 const unsigned depth,
+                 const Move move) {
+    unsigned symmetry;
+    const key_t key = state.getCanonicalKey(symmetry);
+    insert(key, lower_limit, upper_limit, depth,
+            move.transform(symmetry, state.ROWS, state.COLS));
+}
+
+void TPT::insert(const DomineeringState& state,
+                 const score_t score,
+                 const Bound bound,
+                 const unsigned depth,
+                 const Move move) {
+    unsigned symmetry;
+    const key_t key = state.getCanonicalKey(symmetry);
+    insert(key, score, bound, depth,
+            move.transform(symmetry, state.ROWS, state.COLS));
+}
+
+std::string TPT::default_path() {
+    return std::string("config") + Params::separatorChar + "table.bin";
+}
+
+bool TPT::save(std::ostream& os,
+        const unsigned rows,
+        const unsigned cols) const {
+    SnapshotHeader header;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.age = age;
+    header.rows = rows;
+    header.cols = cols;
+    header.bucket_count = bucket_count;
+    header.checksum = checksum(0, buckets, bucket_count);
+
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    os.write(reinterpret_cast<const char*>(buckets),
+            bucket_count * BUCKET_BYTES);
+    return static_cast<bool>(os);
+}
+
+bool TPT::load(std::istream& is,
+        const unsigned rows,
+        const unsigned cols) {
+    clear();
+
+    SnapshotHeader header;
+    if (!is.read(reinterpret_cast<char*>(&header), sizeof(header))
+            || !valid(header, rows, cols)) {
+        return false;
+    }
+
+    std::uint64_t sum = 0;
+    if (header.bucket_count == bucket_count) {
+        // Straight into the table
+        is.read(reinterpret_cast<char*>(buckets),
+                bucket_count * BUCKET_BYTES);
+        sum = checksum(sum, buckets, bucket_count);
     }
     else {
-        table[state] = Entry(lower_limit, upper_limit, nodes_searched);
+        // A chunk at a time, so that the other table never has to fit in
+        // memory
+        const std::size_t CHUNK = 4096;
+        std::vector<Bucket> chunk(CHUNK);
+        for (std::uint64_t done = 0; done < header.bucket_count && is; ) {
+            const std::size_t count = std::min<std::uint64_t>(CHUNK,
+                    header.bucket_count - done);
+            is.read(reinterpret_cast<char*>(chunk.data()),
+                    count * BUCKET_BYTES);
+            sum = checksum(sum, chunk.data(), count);
+            merge(chunk.data(), count);
+            done += count;
+        }
     }
+
+    if (!is || sum != header.checksum) {
+        clear();
+        return false;
+    }
+    age = header.age;
+    return true;
+}
+
+bool TPT::load(const void* snapshot,
+        const std::size_t bytes,
+        const unsigned rows,
+        const unsigned cols) {
+    clear();
+
+    SnapshotHeader header;
+    if (bytes < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, snapshot, sizeof(header));
+    if (!valid(header, rows, cols)
+            || bytes != sizeof(header) + header.bucket_count * BUCKET_BYTES) {
+        return false;
+    }
+
+    const Bucket* from = reinterpret_cast<const Bucket*>(
+            static_cast<const char*>(snapshot) + sizeof(header));
+    if (checksum(0, from, header.bucket_count) != header.checksum) {
+        return false;
+    }
+
+    if (header.bucket_count == bucket_count) {
+        std::memcpy(static_cast<void*>(buckets), from,
+                bucket_count * BUCKET_BYTES);
+    }
+    else {
+        merge(from, header.bucket_count);
+    }
+    age = header.age;
+    return true;
+}
+
+namespace {
+    using limits16 = std::numeric_limits<std::int16_t>;
+
+    // POS_INF and NEG_INF are stored as the ends of the 16-bit range
+    const score_t PACKED_POS_INF = limits16::max();
+    const score_t PACKED_NEG_INF = limits16::min();
+
+    std::uint16_t pack_lower(const score_t s) {
+        score_t p = s == AlphaBeta::POS_INF ? PACKED_POS_INF
+            // Too low to store: the weakest lower limit is still correct
+            : s <= PACKED_NEG_INF ? PACKED_NEG_INF
+            : std::min(s, PACKED_POS_INF - 1);
+        return static_cast<std::uint16_t>(static_cast<std::int16_t>(p));
+    }
+
+    std::uint16_t pack_upper(const score_t s) {
+        score_t p = s == AlphaBeta::NEG_INF ? PACKED_NEG_INF
+            // Too high to store: the weakest upper limit is still correct
+            : s >= PACKED_POS_INF ? PACKED_POS_INF
+            : std::max(s, PACKED_NEG_INF + 1);
+        return static_cast<std::uint16_t>(static_cast<std::int16_t>(p));
+    }
+
+    score_t unpack_score(const std::uint16_t bits) {
+        score_t p = static_cast<std::int16_t>(bits);
+        return p == PACKED_POS_INF ? AlphaBeta::POS_INF
+            : p == PACKED_NEG_INF ? AlphaBeta::NEG_INF
+            : p;
+    }
+} // namespace
+
+std::uint64_t TPT::pack(const score_t lower_limit,
+                        const score_t upper_limit,
+                        const unsigned depth,
+                        const unsigned age,
+                        const Move move) {
+    return std::uint64_t{pack_lower(lower_limit)}
+        | std::uint64_t{pack_upper(upper_limit)} << 16
+        | std::uint64_t{depth & 0xff} << 32
+        | std::uint64_t{age & 0xff} << 40
+        | std::uint64_t{move.bits} << 48;
+}
+
+TPT::Entry TPT::unpack(const std::uint64_t data) {
+    return Entry(unpack_score(data & 0xffff),
+                 unpack_score((data >> 16) & 0xffff),
+                 (data >> 32) & 0xff,
+                 Move::from_bits(data >> 48));
 }
 
 /* Private methods */
 
-void TPT::flip_horizontal(DomineeringState& state) {
-    for (unsigned i = 0; i < state.ROWS; i++) {
-        for (unsigned j = 0; j < state.COLS / 2; j++) {
-            // Row to swap
-            unsigned k = state.ROWS - 1 - i;
-            char a = state.getCell(i, j);
-            char b = state.getCell(k, j);
-            state.setCell(i, j, b);
-            state.setCell(k, j, a);
-        }
+std::uint64_t TPT::checksum(std::uint64_t sum,
+                            const Bucket* from,
+                            const std::size_t count) {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(from);
+    const std::size_t words = count * BUCKET_BYTES / sizeof(std::uint64_t);
+    for (std::size_t i = 0; i < words; i++) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes + i * sizeof(word), sizeof(word));
+        sum = (sum ^ word) * 0x100000001b3ULL;
     }
+    return sum;
+}
+
+bool TPT::valid(const SnapshotHeader& header,
+        const unsigned rows,
+        const unsigned cols) {
+    return std::memcmp(header.magic, SNAPSHOT_MAGIC,
+                sizeof(SNAPSHOT_MAGIC)) == 0
+        && header.version == SNAPSHOT_VERSION
+        && header.age >= 1 && header.age <= 255
+        && header.rows == rows && header.cols == cols
+        && header.bucket_count > 0;
 }
 
-void TPT::flip_vertical(DomineeringState& state) {
-    for (unsigned i = 0; i < state.ROWS; i++) {
-        for (unsigned j = 0; j < state.COLS / 2; j++) {
-            // Column to swap
-            unsigned k = state.COLS - 1 - j;
-            char a = state.getCell(i, j);
-            char b = state.getCell(i, k);
-            state.setCell(i, j, b);
-            state.setCell(i, k, a);
+void TPT::merge(const Bucket* from, const std::size_t count) {
+    for (std::size_t i = 0; i < count; i++) {
+        for (const Slot& slot : from[i].slots) {
+            const std::uint64_t data =
+                slot.data.load(std::memory_order_relaxed);
+            if (data != 0) {
+                // The slot keeps the key XORed with the data
+                place(slot.check.load(std::memory_order_relaxed) ^ data,
+                        data);
+            }
         }
     }
 }
 
-void TPT::rotate_ccw(DomineeringState& state) {
-    unsigned f = std::floor(state.ROWS / 2);
-    unsigned c = std::ceil(state.ROWS / 2);
-    for (unsigned i = 0; i < f; i++) {
-        for (unsigned j = 0; j < c; j++) {
-            unsigned k = state.COLS - 1 - i;
-            unsigned l = state.COLS - 1 - j;
-            char a = state.getCell(i, j);
-            char b = state.getCell(j, k);
-            char c = state.getCell(k, l);
-            char d = state.getCell(l, i);
-            state.setCell(i, j, b);
-            state.setCell(j, k, c);
-            state.setCell(k, l, d);
-            state.setCell(l, i, a);
+void TPT::place(const key_t key, std::uint64_t data) {
+    const std::uint64_t MOVE_BITS = std::uint64_t{0xffff} << 48;
+    const bool has_move = !Move::from_bits(data >> 48).is_none();
+
+    Bucket& bucket = bucket_for(key);
+    Slot* victim = &bucket.slots[0];
+    std::uint64_t victim_data = victim->data.load(std::memory_order_relaxed);
+    for (Slot& slot : bucket.slots) {
+        const std::uint64_t slot_data =
+            slot.data.load(std::memory_order_relaxed);
+        // Same position or a free slot: take it
+        if (slot_data == 0) {
+            victim = &slot;
+            break;
+        }
+        const std::uint64_t old = load(slot, key);
+        if (old != 0) {
+            // A result without a move keeps the move found before
+            if (!has_move) {
+                data = (data & ~MOVE_BITS) | (old & MOVE_BITS);
+            }
+            victim = &slot;
+            break;
+        }
+        // Otherwise replace the entry least worth keeping
+        if (worth(slot_data) < worth(victim_data)) {
+            victim = &slot;
+            victim_data = slot_data;
         }
     }
+    store(*victim, key, data);
 }
 
-void TPT::rotate_cw(DomineeringState& state) {
-    unsigned f = std::floor(state.ROWS / 2);
-    unsigned c = std::ceil(state.ROWS / 2);
-    for (unsigned i = 0; i < f; i++) {
-        for (unsigned j = 0; j < c; j++) {
-            unsigned k = state.COLS - 1 - i;
-            unsigned l = state.COLS - 1 - j;
-            char a = state.getCell(i, j);
-            char b = state.getCell(j, k);
-            char c = state.getCell(k, l);
-            char d = state.getCell(l, i);
-            state.setCell(i, j, d);
-            state.setCell(j, k, a);
-            state.setCell(k, l, b);
-            state.setCell(l, i, c);
-        }
+void TPT::allocate() {
+    void* memory = nullptr;
+    if (posix_memalign(&memory, BUCKET_BYTES, bucket_count * BUCKET_BYTES)) {
+        throw std::bad_alloc();
     }
+    buckets = static_cast<Bucket*>(memory);
 }
 
 /* vim: tw=78:et:ts=4:sts=4:sw=4 */
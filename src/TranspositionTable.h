@@ -3,29 +3,59 @@
 
 #include "DomineeringState.h"
 #include "Evaluators.h"
+#include "Move.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
-#include <fstream>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
 #include <string>
-#include <unordered_map>
 #include <utility>
-#include <vector>
 
 using score_t = Evaluator::score_t;
 
+/**
+ * A fixed-size transposition table.
+ * The whole table is allocated once. It is an array of 64-byte buckets,
+ * each aligned to a cache line and holding four packed entries. A key maps
+ * to exactly one bucket, so a probe touches a single cache line. Inserting
+ * never allocates; when the bucket is full an entry from an older search is
+ * replaced first, then the shallowest one.
+ *
+ * The table is kept from one search to the next. Every search gets a new
+ * age (see new_search) so that entries nobody has looked at since an
+ * earlier move are the first to go.
+ *
+ * The search looks positions up by state rather than by key. A state is
+ * stored under its canonical key (see DomineeringState::getCanonicalKey),
+ * so that one entry serves the board and its mirror images; the best move
+ * is stored as it is on the canonical board and mapped back on lookup.
+ *
+ * check and insert may be called from several search threads at once
+ * without locking. Every slot stores its key XORed with its data, so a
+ * slot that is torn by two threads writing at the same time does not
+ * verify and reads as a miss.
+ */
 class TranspositionTable {
 public:
+    /**
+     * Zobrist key of a position, as given by DomineeringState::getKey.
+     */
+    using key_t = std::uint64_t;
+
     /**
      * A simple struct that represents an entry in the transposition table.
-     * The `nodes_searched' member variable is used when deleting old elements
-     * when the table gets too large.
+     * This is the unpacked form of what is stored in a bucket.
      */
     struct Entry {
         Entry();
         Entry(const score_t lower_limit,
               const score_t upper_limit,
-              const long unsigned nodes_searched);
+              const unsigned depth,
+              const Move move = Move());
         Entry(const Entry& other);
         Entry(Entry&& other);
 
@@ -33,40 +63,55 @@ public:
         Entry& operator=(Entry&& other);
 
         score_t lower_limit, upper_limit;
-        long unsigned nodes_searched;
+        /* Number of plies that were searched under the position */
+        unsigned depth;
+        /* Best move found, none if there is none */
+        Move move;
     };
 
-    // Declare type of table here so that key-value size can be calculated
-    using table_t = std::unordered_map<DomineeringState, Entry>;
-
     /**
-     * Maximum memory we should use in megabytes.
+     * What a score found by a search says about the true value, from the
+     * point of view of the side it was found for: EXACT if every child was
+     * searched inside the window, LOWER after a cutoff (fail high), UPPER if
+     * no child reached the window (fail low).
      */
-    static const unsigned MEM_LIMIT = 500;
+    enum class Bound {
+        EXACT,
+        LOWER,
+        UPPER
+    };
 
     static const unsigned BYTES_PER_MEGABYTE = 1024 * 1024;
 
+    static const unsigned BUCKET_BYTES = 64;
+
+    static const unsigned ENTRIES_PER_BUCKET = 4;
+
     /**
-     * The amount of memory it takes for one entry in bytes.
-     * Estimated by adding the size of hash key and value.
+     * Depth that wins and losses are stored with. A proven result holds
+     * however deep the probe wants to look.
      */
-    static constexpr size_t BYTES_PER_ENTRY =
-        sizeof(typename table_t::value_type);
+    static const unsigned PROVEN_DEPTH = 255;
 
     /**
-     * Maximum number of entries to store in the transposition table.
-     * 0 for unlimited.
+     * Version of the snapshot format (see save). Changes whenever the
+     * layout of a slot or of the header does.
      */
-    static constexpr unsigned TP_MAX =
-        MEM_LIMIT * BYTES_PER_MEGABYTE / BYTES_PER_ENTRY;
+    static const std::uint32_t SNAPSHOT_VERSION = 4;
 
     /**
-     * How much entries to get rid of in one shrink.
+     * Creates a table that uses the memory budget from the settings.
      */
-    static constexpr float SHRINK_RATE = 0.8;
-
     TranspositionTable();
 
+    /**
+     * Creates a table that uses exactly the given memory budget, rounded
+     * down to whole buckets.
+     *
+     * \param[in] megabytes size of the table in megabytes.
+     */
+    explicit TranspositionTable(const unsigned megabytes);
+
     TranspositionTable(const TranspositionTable& other);
 
     TranspositionTable(TranspositionTable&& other);
@@ -83,31 +128,99 @@ public:
     void clear();
 
     /**
-     * Shrinks the transposition table by removing entries that have smaller
-     * searched nodes count.
+     * Starts a new age. Entries stored or hit from now on are stamped with
+     * it; entries with an older stamp are replaced first.
+     */
+    void new_search();
+
+    /**
+     * \return the number of entries the table can hold.
+     */
+    std::size_t capacity() const;
+
+    /**
+     * \return where snapshots are kept between runs: config/table.bin.
+     */
+    static std::string default_path();
+
+    /**
+     * Writes a snapshot of the table: a header with the version, the
+     * current age, the size of the board, the number of buckets and a
+     * checksum of the buckets, followed by the buckets as they are in
+     * memory. No search may be running.
+     *
+     * \param[out] os the stream to write to, opened in binary mode.
+     *
+     * \param[in] rows the rows of the board the entries are for.
+     *
+     * \param[in] cols the columns of the board the entries are for.
+     *
+     * \return false if writing failed.
+     */
+    bool save(std::ostream& os,
+              const unsigned rows,
+              const unsigned cols) const;
+
+    /**
+     * Reads a snapshot written by save. If the snapshot has a different
+     * number of buckets, its entries are inserted one by one; otherwise the
+     * buckets are copied as they are. No search may be running.
+     *
+     * \param[in] is the stream to read from, opened in binary mode.
+     *
+     * \param[in] rows the rows of the board being played.
+     *
+     * \param[in] cols the columns of the board being played.
+     *
+     * \return false if the stream does not hold a valid snapshot of this
+     *         version, the snapshot is for a board of another size (the
+     *         keys of its cells would mean other positions), or the
+     *         checksum does not match. The table is empty then.
+     */
+    bool load(std::istream& is, const unsigned rows, const unsigned cols);
+
+    /**
+     * Same as above, from a snapshot in memory (e.g. a mapped file).
+     *
+     * \param[in] snapshot the start of the snapshot.
+     *
+     * \param[in] bytes the size of the snapshot.
      */
-    void shrink();
+    bool load(const void* snapshot,
+              const std::size_t bytes,
+              const unsigned rows,
+              const unsigned cols);
 
     /**
      * Checks for existence in the transposition table.
-     * If the given state is not a hit, this method will try to find the same
-     * transposition of the state (vertically and horizontally symmetrical).
+     * A hit is stamped with the current age so that it survives into the
+     * next search. Note that the entry may have been searched shallower than
+     * what the caller needs; see AlphaBeta::can_prune.
+     *
+     * \param[in] key the Zobrist key of the state to check.
      *
-     * \param[in] state the state to check
+     * \return a std::pair<Entry, bool> where the first element is the entry
+     *         and the second element is true if there was a hit, false
+     *         otherwise.
+     */
+    std::pair<Entry, bool> check(const key_t key);
+
+    /**
+     * Same as above, for a state and its mirror images. The move of the
+     * entry is the one on `state'.
      *
-     * \return a std::pair<score_t, bool> where the first element is the score
-     *         and the second element is true if there was a hit in any of the
-     *         transposition, false otherwise.
+     * \param[in] state the state to check.
      */
     std::pair<Entry, bool> check(const DomineeringState& state);
 
     /**
      * Adds the current state and the resulting score to the transposition
      * table.
-     * If the number of entries in the table exceeds a threashold, some
-     * entries in the transposition table are deleted.
+     * If the bucket of the state is full, the entry least worth keeping is
+     * replaced: one left over from an earlier search if there is any, the
+     * shallowest one otherwise.
      *
-     * \param[in] state the current state.
+     * \param[in] key the Zobrist key of the current state.
      *
      * \param[in] lower_limit the lowest possible score that is guarenteed to
      *                        be found when further searching down the tree.
@@ -115,57 +228,214 @@ public:
      * \param[in] upper_limit the highest possible score that is guarenteed to
      *                        be found when further searching down the tree.
      *
-     * \param[in] nodes_searched the number of nodes searched up to the point
-     *            of insertion. This is used when the table gets too large and
-     *            needs to be shrunk.
+     * \param[in] depth the number of plies searched under the state.
+     *
+     * \param[in] move the best move found, if any. Without one, the move
+     *                 stored for the state before is kept.
      */
-    void insert(const DomineeringState& state,
+    void insert(const key_t key,
                 const score_t lower_limit,
                 const score_t upper_limit,
-                const long unsigned nodes_searched);
+                const unsigned depth,
+                const Move move = Move());
 
-private:
     /**
-     * The transposition table.
-     * This table is used to look up board configurations that have already
-     * been explored.
+     * Same as above, with the result as a score and a bound. The bound is
+     * turned into the limits the table keeps.
+     *
+     * \param[in] key the Zobrist key of the current state.
+     *
+     * \param[in] score the score of the state for HOME.
+     *
+     * \param[in] bound what `score' is for HOME: the exact value, a lower
+     *                  limit or an upper limit.
+     *
+     * \param[in] depth the number of plies searched under the state.
      *
-     * Key: the state.
-     * Val: a pair of resulting score and the move number this entry was added.
+     * \param[in] move see above.
      */
-    table_t table;
+    void insert(const key_t key,
+                const score_t score,
+                const Bound bound,
+                const unsigned depth,
+                const Move move = Move());
 
     /**
-     * Flips the board horizontally (along the x-axis).
+     * Same as the two above, for a state and its mirror images.
      *
-     * \param[out] state the state to be flipped.
+     * \param[in] state the current state. `move' is a move on it.
      */
-    void flip_horizontal(DomineeringState& state);
+    void insert(const DomineeringState& state,
+                const score_t lower_limit,
+                const score_t upper_limit,
+                const unsigned depth,
+                const Move move = Move());
 
+    void insert(const DomineeringState& state,
+                const score_t score,
+                const Bound bound,
+                const unsigned depth,
+                const Move move = Move());
+
+private:
     /**
-     * Flips the board vertically (along the y-axis).
+     * One packed entry: the limits, depth and age in a single 64-bit word,
+     * and the full key XORed with that word for verification. Both words
+     * are read and written with relaxed atomics; a slot is only believed
+     * if they agree.
      *
-     * \param[out] state the state to be flipped.
+     *   bits  0-15  lower limit
+     *   bits 16-31  upper limit
+     *   bits 32-39  depth
+     *   bits 40-47  age
+     *   bits 48-63  best move (see Move)
+     *
+     * A slot whose data is 0 is empty.
      */
-    void flip_vertical(DomineeringState& state);
+    struct Slot {
+        std::atomic<key_t> check;
+        std::atomic<std::uint64_t> data;
+    };
+
+    struct alignas(64) Bucket {
+        Slot slots[ENTRIES_PER_BUCKET];
+    };
+
+    static_assert(sizeof(Bucket) == BUCKET_BYTES,
+                  "a bucket must fill exactly one cache line");
 
     /**
-     * Rotates the board counter-clockwise 90 degrees.
-     *
-     * \param[out] state the state to be rotated.
+     * First bytes of a snapshot.
+     */
+    struct SnapshotHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t age;
+        std::uint32_t rows;
+        std::uint32_t cols;
+        std::uint64_t bucket_count;
+        std::uint64_t checksum;
+    };
+
+    static const char SNAPSHOT_MAGIC[8];
+
+    /**
+     * Continues a checksum (FNV-1a over 64-bit words) over some buckets.
+     */
+    static std::uint64_t checksum(std::uint64_t sum,
+                                  const Bucket* from,
+                                  const std::size_t count);
+
+    /**
+     * \return true if the header belongs to a snapshot that this table can
+     *         read, of a board of the given size.
+     */
+    static bool valid(const SnapshotHeader& header,
+                      const unsigned rows,
+                      const unsigned cols);
+
+    /**
+     * Inserts every entry of the given buckets, which may come from a table
+     * of another size, keeping their depth and age.
+     */
+    void merge(const Bucket* from, const std::size_t count);
+
+    /**
+     * Puts the packed data of a key into its bucket, replacing the entry
+     * least worth keeping if the bucket is full.
+     */
+    void place(const key_t key, std::uint64_t data);
+
+    /**
+     * Packs the limits into 16 bits each. POS_INF and NEG_INF map to the
+     * ends of the 16-bit range; other scores are clamped so that the packed
+     * limits are never tighter than the real ones.
+     */
+    static std::uint64_t pack(const score_t lower_limit,
+                              const score_t upper_limit,
+                              const unsigned depth,
+                              const unsigned age,
+                              const Move move);
+
+    static Entry unpack(const std::uint64_t data);
+
+    /**
+     * \return the bucket the key maps to.
      */
-    void rotate_ccw(DomineeringState& state);
+    Bucket& bucket_for(const key_t key) const;
 
     /**
-     * Rotates the board clockwise 90 degrees.
+     * Reads a slot.
      *
-     * \param[out] state the state to be rotated.
+     * \param[in] slot the slot to read.
+     *
+     * \param[in] key the key that is looked for.
+     *
+     * \return the data of the slot if it holds `key', 0 otherwise.
+     */
+    static std::uint64_t load(const Slot& slot, const key_t key);
+
+    /**
+     * Writes a slot.
+     */
+    static void store(Slot& slot, const key_t key, const std::uint64_t data);
+
+    /**
+     * Allocates `bucket_count' cache-aligned buckets.
+     */
+    void allocate();
+
+    Bucket* buckets;
+
+    std::size_t bucket_count;
+
+    /**
+     * Age stamped on new entries. Runs from 1 to 255 and wraps around; never
+     * 0, so that a used slot never looks empty.
      */
-    void rotate_cw(DomineeringState& state);
+    unsigned age;
+
+    /**
+     * How much an entry is worth keeping. Entries of the current age always
+     * beat older ones; among the same age deeper ones are worth more.
+     */
+    unsigned worth(const std::uint64_t data) const;
 };
 
-inline void TranspositionTable::clear() {
-    table.clear();
+inline std::size_t TranspositionTable::capacity() const {
+    return bucket_count * ENTRIES_PER_BUCKET;
+}
+
+inline void TranspositionTable::new_search() {
+    age = age % 255 + 1;
+}
+
+inline unsigned TranspositionTable::worth(const std::uint64_t data) const {
+    const unsigned slot_age = (data >> 40) & 0xff;
+    const unsigned depth = (data >> 32) & 0xff;
+    return (slot_age == age ? 256 : 0) + depth;
+}
+
+inline std::uint64_t TranspositionTable::load(const Slot& slot,
+                                              const key_t key) {
+    const std::uint64_t data = slot.data.load(std::memory_order_relaxed);
+    const key_t check = slot.check.load(std::memory_order_relaxed);
+    return (check ^ data) == key ? data : 0;
+}
+
+inline void TranspositionTable::store(Slot& slot,
+                                      const key_t key,
+                                      const std::uint64_t data) {
+    slot.check.store(key ^ data, std::memory_order_relaxed);
+    slot.data.store(data, std::memory_order_relaxed);
+}
+
+inline TranspositionTable::Bucket&
+TranspositionTable::bucket_for(const key_t key) const {
+    // Maps the low 32 bits of the key onto [0, bucket_count) with a multiply
+    // instead of a modulo, so the bucket count does not need to be a power
+    // of two
+    return buckets[((key & 0xffffffff) * bucket_count) >> 32];
 }
 
 #endif /* end of include guard */
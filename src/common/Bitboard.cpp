@@ -0,0 +1,21 @@
+#include "Bitboard.h"
+
+#include <stdexcept>
+
+const unsigned Bitboard::WORD_BITS;
+const unsigned Bitboard::MAX_CELLS;
+const unsigned Bitboard::MAX_WORDS;
+
+unsigned Bitboard::words = 1;
+
+void Bitboard::init(const unsigned cells) {
+    if (cells > MAX_CELLS) {
+        throw std::length_error("board does not fit in a Bitboard");
+    }
+    words = (cells + WORD_BITS - 1) / WORD_BITS;
+    if (words == 0) {
+        words = 1;
+    }
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
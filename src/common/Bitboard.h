@@ -0,0 +1,227 @@
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include <cstdint>
+
+/**
+ * A set of cells on the board, one bit per cell.
+ * Cell (r, c) is stored at bit r * COLS + c. An 8x8 board fits in a single
+ * word; larger boards (up to 16x16) spill over into the following words.
+ *
+ * The number of words in use depends only on the board size, which is the
+ * same for every state in the process, so it is kept in a static member that
+ * is set once through Bitboard::init. Words past that count are always zero.
+ */
+struct Bitboard {
+    using word_t = std::uint64_t;
+
+    static const unsigned WORD_BITS = 64;
+    static const unsigned MAX_CELLS = 256;
+    static const unsigned MAX_WORDS = MAX_CELLS / WORD_BITS;
+
+    /**
+     * Sets the number of words used by every bitboard.
+     *
+     * \param[in] cells number of cells on the board (ROWS * COLS).
+     */
+    static void init(const unsigned cells);
+
+    /**
+     * Number of words in use.
+     */
+    static unsigned words;
+
+    Bitboard()
+        : w{0, 0, 0, 0}
+    { }
+
+    /**
+     * \return true if the bit for the given cell is set.
+     */
+    bool test(const unsigned i) const {
+        return (w[i / WORD_BITS] >> (i % WORD_BITS)) & 1;
+    }
+
+    void set(const unsigned i) {
+        w[i / WORD_BITS] |= word_t{1} << (i % WORD_BITS);
+    }
+
+    void reset(const unsigned i) {
+        w[i / WORD_BITS] &= ~(word_t{1} << (i % WORD_BITS));
+    }
+
+    /**
+     * \return true if at least one bit is set.
+     */
+    bool any() const;
+
+    /**
+     * \return the number of set bits.
+     */
+    unsigned count() const;
+
+    /**
+     * \return the index of the lowest set bit. Undefined if no bit is set.
+     */
+    unsigned lowest() const;
+
+    /**
+     * Clears the lowest set bit and returns its index.
+     * Used to walk through the cells of a move set:
+     *
+     *     while (moves.any()) {
+     *         unsigned cell = moves.pop_lowest();
+     *         ...
+     *     }
+     */
+    unsigned pop_lowest();
+
+    Bitboard& operator&=(const Bitboard& o);
+    Bitboard& operator|=(const Bitboard& o);
+    Bitboard& operator^=(const Bitboard& o);
+
+    Bitboard operator&(const Bitboard& o) const;
+    Bitboard operator|(const Bitboard& o) const;
+    Bitboard operator^(const Bitboard& o) const;
+    Bitboard operator~() const;
+
+    /**
+     * Shifts towards lower cell indices, i.e. bit i of the result is bit
+     * i + n of this bitboard.
+     */
+    Bitboard operator>>(const unsigned n) const;
+
+    /**
+     * Shifts towards higher cell indices, i.e. bit i + n of the result is
+     * bit i of this bitboard. Bits shifted past the last word are dropped,
+     * but bits past the last cell are not; mask the result if needed.
+     */
+    Bitboard operator<<(const unsigned n) const;
+
+    bool operator==(const Bitboard& o) const;
+    bool operator!=(const Bitboard& o) const;
+
+    word_t w[MAX_WORDS];
+};
+
+inline bool Bitboard::any() const {
+    for (unsigned i = 0; i < words; i++) {
+        if (w[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline unsigned Bitboard::count() const {
+    unsigned n = 0;
+    for (unsigned i = 0; i < words; i++) {
+        n += __builtin_popcountll(w[i]);
+    }
+    return n;
+}
+
+inline unsigned Bitboard::lowest() const {
+    unsigned i = 0;
+    while (!w[i]) {
+        i++;
+    }
+    return i * WORD_BITS + __builtin_ctzll(w[i]);
+}
+
+inline unsigned Bitboard::pop_lowest() {
+    unsigned i = 0;
+    while (!w[i]) {
+        i++;
+    }
+    unsigned bit = __builtin_ctzll(w[i]);
+    w[i] &= w[i] - 1;
+    return i * WORD_BITS + bit;
+}
+
+inline Bitboard& Bitboard::operator&=(const Bitboard& o) {
+    for (unsigned i = 0; i < words; i++) {
+        w[i] &= o.w[i];
+    }
+    return *this;
+}
+
+inline Bitboard& Bitboard::operator|=(const Bitboard& o) {
+    for (unsigned i = 0; i < words; i++) {
+        w[i] |= o.w[i];
+    }
+    return *this;
+}
+
+inline Bitboard& Bitboard::operator^=(const Bitboard& o) {
+    for (unsigned i = 0; i < words; i++) {
+        w[i] ^= o.w[i];
+    }
+    return *this;
+}
+
+inline Bitboard Bitboard::operator&(const Bitboard& o) const {
+    Bitboard b{*this};
+    return b &= o;
+}
+
+inline Bitboard Bitboard::operator|(const Bitboard& o) const {
+    Bitboard b{*this};
+    return b |= o;
+}
+
+inline Bitboard Bitboard::operator^(const Bitboard& o) const {
+    Bitboard b{*this};
+    return b ^= o;
+}
+
+inline Bitboard Bitboard::operator~() const {
+    Bitboard b;
+    for (unsigned i = 0; i < words; i++) {
+        b.w[i] = ~w[i];
+    }
+    return b;
+}
+
+inline Bitboard Bitboard::operator>>(const unsigned n) const {
+    const unsigned skip = n / WORD_BITS;
+    const unsigned bits = n % WORD_BITS;
+    Bitboard b;
+    for (unsigned i = 0; i + skip < words; i++) {
+        b.w[i] = w[i + skip] >> bits;
+        if (bits != 0 && i + skip + 1 < words) {
+            b.w[i] |= w[i + skip + 1] << (WORD_BITS - bits);
+        }
+    }
+    return b;
+}
+
+inline Bitboard Bitboard::operator<<(const unsigned n) const {
+    const unsigned skip = n / WORD_BITS;
+    const unsigned bits = n % WORD_BITS;
+    Bitboard b;
+    for (unsigned i = skip; i < words; i++) {
+        b.w[i] = w[i - skip] << bits;
+        if (bits != 0 && i > skip) {
+            b.w[i] |= w[i - skip - 1] >> (WORD_BITS - bits);
+        }
+    }
+    return b;
+}
+
+inline bool Bitboard::operator==(const Bitboard& o) const {
+    for (unsigned i = 0; i < words; i++) {
+        if (w[i] != o.w[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+inline bool Bitboard::operator!=(const Bitboard& o) const {
+    return !(*this == o);
+}
+
+#endif /* end of include guard */
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
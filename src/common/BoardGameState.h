@@ -87,7 +87,7 @@ public:
      */
     inline virtual ~BoardGameState() {}
     
-private:
+protected:
     
     void thisGameReset() override;
     
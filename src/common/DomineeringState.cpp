@@ -9,6 +9,24 @@
 #include "DomineeringState.h"
 #include <cstdlib>
 #include <algorithm>
+#include <random>
+
+static std::array<std::uint64_t, Bitboard::MAX_CELLS> makeZobristKeys() {
+    std::array<std::uint64_t, Bitboard::MAX_CELLS> keys;
+    std::mt19937_64 rng(0x5eed);
+    for (auto &k : keys)
+        k = rng();
+    return keys;
+}
+
+const std::array<std::uint64_t, Bitboard::MAX_CELLS>
+DomineeringState::zobristKeys = makeZobristKeys();
+
+const unsigned DomineeringState::SYMMETRIES;
+
+std::array<std::array<std::uint64_t, Bitboard::MAX_CELLS>,
+           DomineeringState::SYMMETRIES>
+DomineeringState::symmetricZobristKeys;
 
 
 GameState* DomineeringState::create() {
@@ -25,7 +43,29 @@ DomineeringState::DomineeringState() : BoardGameState
      getDomineeringParams().intValue("COLS"),
      getDomineeringParams().charValue("HOMESYM"),
      getDomineeringParams().charValue("AWAYSYM"),
-     getDomineeringParams().charValue("EMPTYSYM")) {}
+     getDomineeringParams().charValue("EMPTYSYM")) {
+    Bitboard::init(ROWS*COLS);
+    initSymmetries();
+    for (int r = 0; r < ROWS; r++) {
+        for (int c = 0; c + 1 < COLS; c++) {
+            notLastColumnMask.set(r*COLS+c);
+            notFirstColumnMask.set(r*COLS+c+1);
+        }
+    }
+    syncBitboard();
+}
+
+void DomineeringState::initSymmetries() {
+    for (unsigned s = 0; s < SYMMETRIES; s++) {
+        for (int r = 0; r < ROWS; r++) {
+            for (int c = 0; c < COLS; c++) {
+                const int mr = s & 2 ? ROWS - 1 - r : r;
+                const int mc = s & 1 ? COLS - 1 - c : c;
+                symmetricZobristKeys[s][r*COLS+c] = zobristKeys[mr*COLS+mc];
+            }
+        }
+    }
+}
 
 bool DomineeringState::moveOK(const GameMove &gm) const {
     const DomineeringMove mv = static_cast<const DomineeringMove&>(gm);
@@ -41,25 +81,43 @@ bool DomineeringState::moveOK(const GameMove &gm) const {
     return false;
 }
 
+void DomineeringState::thisGameReset() {
+    BoardGameState::thisGameReset();
+    syncBitboard();
+}
+
+void DomineeringState::thisGameParseMsg(const std::string &s) {
+    BoardGameState::thisGameParseMsg(s);
+    syncBitboard();
+}
+
 void DomineeringState::thisGameMakeMove(const GameMove &gm) {
     const DomineeringMove &mv = static_cast<const DomineeringMove&>(gm);
     char playerSymbol = getWho() == Who::HOME ? HOMESYM : AWAYSYM;
     board[mv.row1()*COLS+mv.col1()] = playerSymbol;
     board[mv.row2()*COLS+mv.col2()] = playerSymbol;
+    empty.reset(mv.row1()*COLS+mv.col1());
+    empty.reset(mv.row2()*COLS+mv.col2());
+    for (unsigned s = 0; s < SYMMETRIES; s++)
+        keys[s] ^= symmetricZobristKeys[s][mv.row1()*COLS+mv.col1()]
+                 ^ symmetricZobristKeys[s][mv.row2()*COLS+mv.col2()];
 }
 
 Status DomineeringState::thisGameCheckTerminalUpdateStatus() {
-    if (getWho() == Who::HOME) {
-        int c = -1;
-        return std::any_of(board.begin(), board.end(), [&](const char &ch) {
-            c = c == 8 ? 0 : c+1;
-            return ch == EMPTYSYM && c+1 != COLS && *(&ch+1) == EMPTYSYM;
-        }) ? Status::GAME_ON : Status::AWAY_WIN;
-    } else {
-        return std::any_of(board.begin(), board.end(), [&](char &ch) {
-            return ch == EMPTYSYM && &ch - board.data() + COLS <= ROWS*COLS
-                   && *(&ch+COLS) == EMPTYSYM;
-        }) ? Status::GAME_ON : Status::HOME_WIN;
+    if (hasMoves(getWho()))
+        return Status::GAME_ON;
+    return getWho() == Who::HOME ? Status::AWAY_WIN : Status::HOME_WIN;
+}
+
+void DomineeringState::syncBitboard() {
+    empty = Bitboard();
+    keys.fill(0);
+    for (int i = 0; i < ROWS*COLS; i++) {
+        if (board[i] == EMPTYSYM)
+            empty.set(i);
+        else
+            for (unsigned s = 0; s < SYMMETRIES; s++)
+                keys[s] ^= symmetricZobristKeys[s][i];
     }
 }
 
@@ -11,12 +11,23 @@
 
 #include "Params.h"
 #include "BoardGameState.h"
+#include "Bitboard.h"
 #include "DomineeringMove.h"
+#include <array>
+#include <cstdint>
 #include <stdio.h>
 #include <vector>
 
 class DomineeringState : public BoardGameState {
 public:
+
+    /**
+     * Number of symmetries that keep horizontal dominoes horizontal: the
+     * identity, mirroring left to right (1), top to bottom (2), and both
+     * (3), i.e. turning the board half way round. The rest of the symmetries
+     * of a square board swap HOME and AWAY.
+     */
+    static const unsigned SYMMETRIES = 4;
     
     static Params& getDomineeringParams();
     
@@ -26,36 +37,211 @@ public:
     
 	DomineeringState();
 
+    //-------------------------------------------------------------
+    //----------------------- BITBOARD MODE -----------------------
+    //-------------------------------------------------------------
+
+    /**
+     * Cells that are currently empty. Kept in sync with the char board by
+     * every method of this class; BoardGameState::setCell does NOT update it.
+     */
+    inline const Bitboard& getEmpty() const { return empty; }
+
+    /**
+     * Every cell except those in the last column, i.e. the cells that can
+     * anchor a horizontal domino.
+     */
+    inline const Bitboard& getNotLastColumn() const {
+        return notLastColumnMask;
+    }
+
+    /**
+     * Every cell except those in the first column.
+     */
+    inline const Bitboard& getNotFirstColumn() const {
+        return notFirstColumnMask;
+    }
+
+    /**
+     * Anchor cells of every legal domino for the given side: the left
+     * cell of a horizontal (HOME) domino, the lower-row cell of a vertical
+     * (AWAY) domino.
+     * @param who the side to generate moves for
+     * @return bitboard of anchor cells
+     */
+    Bitboard movesFor(Who who) const;
+
+    /**
+     * @param who the side to check
+     * @return true if the side has at least one legal domino
+     */
+    bool hasMoves(Who who) const;
+
+    /**
+     * The second cell covered by a domino anchored at the given cell.
+     */
+    inline int otherCell(int cell, Who who) const {
+        return who == Who::HOME ? cell + 1 : cell + COLS;
+    }
+
+    /**
+     * Number of plies a search can reach on a board of the given size,
+     * counting the root: every ply fills two cells, and Lazy SMP helpers
+     * go one ply past the end of the game at most. Everything the searcher
+     * keeps per ply is sized with it.
+     * @param rows the rows of the board
+     * @param cols the columns of the board
+     */
+    static inline unsigned maxPlies(unsigned rows, unsigned cols) {
+        return rows * cols / 2 + 2;
+    }
+
+    /**
+     * Places a domino of the given side without any validity checks and
+     * without touching the turn or move count. Used by the searcher to
+     * simulate a move; removeDomino undoes it.
+     * @param cell anchor cell of the domino, as given by movesFor
+     * @param who side that owns the domino
+     */
+    void placeDomino(int cell, Who who);
+
+    /**
+     * Undoes placeDomino.
+     */
+    void removeDomino(int cell, Who who);
+
+    /**
+     * Zobrist key of the position: the XOR of one random number per
+     * occupied cell. Whose turn it is does not need to be part of the key
+     * since HOME always moves first, so the number of empty cells already
+     * tells whose turn it is. Updated with two XORs per domino.
+     * @return 64-bit key of the current position
+     */
+    inline std::uint64_t getKey() const { return keys[0]; }
+
+    /**
+     * Zobrist key of the board transformed by one of the symmetries. All
+     * of them are kept up to date along with getKey.
+     * @param symmetry the symmetry, below SYMMETRIES; 0 gives getKey()
+     */
+    inline std::uint64_t getSymmetricKey(unsigned symmetry) const {
+        return keys[symmetry];
+    }
+
+    /**
+     * The smallest key of the board under the symmetries. Positions that
+     * are mirror images of each other have the same canonical key.
+     * @param symmetry set to the symmetry that gives the smallest key, i.e.
+     *                 takes the board to the canonical one
+     * @return the canonical key
+     */
+    std::uint64_t getCanonicalKey(unsigned &symmetry) const;
+
+    /**
+     * The random number of a cell, as XORed into the key when the cell
+     * is occupied. Lets others compute the key of a transformed board.
+     * @param cell index of the cell (r * COLS + c)
+     */
+    static inline std::uint64_t getZobristKey(int cell) {
+        return zobristKeys[cell];
+    }
+
 private:
         
+    void thisGameReset() override;
+
+    void thisGameParseMsg(const std::string &s) override;
+
     void thisGameMakeMove(const GameMove &gm) override;
     
     Status thisGameCheckTerminalUpdateStatus() override;
 
+    /**
+     * Rebuilds the bitboard and the Zobrist key from the char board.
+     */
+    void syncBitboard();
+
+    /**
+     * Fills symmetricZobristKeys for the size of this board, which is the
+     * same for every state in the process.
+     */
+    void initSymmetries();
+
+    /**
+     * One random number per cell. Generated from a fixed seed so that keys
+     * are the same from one run to the next.
+     */
+    static const std::array<std::uint64_t, Bitboard::MAX_CELLS> zobristKeys;
+
+    /**
+     * For each symmetry, the random number of the cell each cell is taken
+     * to, so that a domino updates every key with two XORs.
+     */
+    static std::array<std::array<std::uint64_t, Bitboard::MAX_CELLS>,
+                      SYMMETRIES> symmetricZobristKeys;
+
+    Bitboard empty;
+
+    // Key of the board under each symmetry; keys[0] is the board as it is
+    std::array<std::uint64_t, SYMMETRIES> keys;
+
+    // Every cell except those in the last column, i.e. the cells that can
+    // anchor a horizontal domino
+    Bitboard notLastColumnMask;
+
+    // Every cell except those in the first column
+    Bitboard notFirstColumnMask;
 };
 
-/**
- * Combine operation of two hash keys. Based on boost::hash_combine.
- */
-namespace {
-    void hash_combine(std::size_t& h, const std::size_t& v) {
-        h ^= v + 0x9e3779b9 + (h << 6) + (h >> 2);
+inline Bitboard DomineeringState::movesFor(Who who) const {
+    if (who == Who::HOME) {
+        return empty & (empty >> 1) & notLastColumnMask;
+    }
+    return empty & (empty >> COLS);
+}
+
+inline bool DomineeringState::hasMoves(Who who) const {
+    return movesFor(who).any();
+}
+
+inline void DomineeringState::placeDomino(int cell, Who who) {
+    int other = otherCell(cell, who);
+    char sym = who == Who::HOME ? HOMESYM : AWAYSYM;
+    board[cell] = sym;
+    board[other] = sym;
+    empty.reset(cell);
+    empty.reset(other);
+    for (unsigned s = 0; s < SYMMETRIES; s++)
+        keys[s] ^= symmetricZobristKeys[s][cell]
+                 ^ symmetricZobristKeys[s][other];
+}
+
+inline void DomineeringState::removeDomino(int cell, Who who) {
+    int other = otherCell(cell, who);
+    board[cell] = EMPTYSYM;
+    board[other] = EMPTYSYM;
+    empty.set(cell);
+    empty.set(other);
+    for (unsigned s = 0; s < SYMMETRIES; s++)
+        keys[s] ^= symmetricZobristKeys[s][cell]
+                 ^ symmetricZobristKeys[s][other];
+}
+
+inline std::uint64_t DomineeringState::getCanonicalKey(
+        unsigned &symmetry) const {
+    symmetry = 0;
+    for (unsigned s = 1; s < SYMMETRIES; s++) {
+        if (keys[s] < keys[symmetry])
+            symmetry = s;
     }
+    return keys[symmetry];
 }
 
 namespace std {
     template<>
     struct hash<DomineeringState> {
         size_t operator()(const DomineeringState& ds) const {
-            size_t h = 0;
-            const std::vector<char>& board = *ds.getBoard1D();
-            const unsigned lim = board.size();
-            for (unsigned i = 0; i < lim; i++) {
-                if (board[i] == ds.EMPTYSYM) {
-                    hash_combine(h, std::hash<unsigned>()(i));
-                }
-            }
-            return h;
+            return ds.getKey();
         }
     };
 } // namespace std
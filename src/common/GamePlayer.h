@@ -66,7 +66,7 @@ public:
      * should come shortly thereafter. Default behavior is to do nothing.
      * @param opponent Name of the opponent being played
      */
-    inline void startGame(std::string opponentName) { }
+    virtual inline void startGame(std::string opponentName) { }
     
     /**
      * Called to inform the player how long the last move took. This can
@@ -74,7 +74,7 @@ public:
      * to do nothing.
      * @param secs Time for the server to receive the last move
      */
-    inline void timeOfLastMove(double secs) { }
+    virtual inline void timeOfLastMove(double secs) { }
     
     /**
      * Called when the game has ended. Default behavior is to do nothing.
@@ -106,9 +106,13 @@ protected:
      */
     GamePlayer(std::string nickname, std::string gameName);
     
-private:
+    /**
+     * Parameters of the tournament, read from config/tournament.txt
+     */
     static Params& tournamentParams();
     
+private:
+    
     GameState *st;
     TCPClient client;
     Who side;
@@ -0,0 +1,717 @@
+#include "BoardKernels.h"
+#include "DomineeringState.h"
+#include "IncrementalEvaluator.h"
+#include "Node.h"
+#include "RegionSolver.h"
+#include "Searcher.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * Benchmarks for the searcher. Run from the build directory so that the
+ * config files are found.
+ *
+ *   bench smp <depth> [max threads] [positions]
+ *       Time to depth and nodes per second with 1, 2, 4, ... threads, for
+ *       Lazy SMP and for YBWC on the same positions. Each configuration
+ *       searches them once untimed to warm up the region solvers, and is
+ *       timed on the second pass.
+ *
+ *   bench search <depth> [positions]
+ *       Nodes and time to depth for each search algorithm on one thread,
+ *       on positions with either side to move. Checks that they all agree
+ *       on the score, and that the move each plays reaches it and starts
+ *       the principal variation it reports.
+ *
+ *   bench endgame <plies> [positions]
+ *       Solves positions after the given number of random plies, with and
+ *       without solving regions, and checks that both find the same winner.
+ *       Uses config/regions.tb if there is one.
+ *
+ *   bench transpose <plies> [positions]
+ *       Solves the regions of positions after the given number of random
+ *       plies with a region solver that shares values between a shape and
+ *       its transpose, and with one that does not. Checks that both find
+ *       the same values, and shows how many shapes each had to solve.
+ *
+ *   bench eval [positions]
+ *       Evaluates positions after every number of random plies, from the
+ *       start to a full board, with the scans that mark the board and with
+ *       the bitboard evaluator. Then plays random games to the end and
+ *       back with the incremental evaluator, checking it against the
+ *       bitboard one after every move. Checks that every feature comes out
+ *       the same, and shows the time per evaluation of each; for the
+ *       incremental one, that includes making the move and taking it back.
+ *
+ *   bench kernels [positions]
+ *       Times move generation and evaluation with each version of
+ *       BoardKernels the CPU supports (scalar, SSE2, AVX2) on positions
+ *       after every number of random plies, and checks that they all agree
+ *       with the scalar one.
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * Positions to search: a few random plies from the start, always the same
+ * for the same seed.
+ *
+ * \param[in] count number of positions.
+ *
+ * \param[in] plies number of random plies played on each.
+ */
+std::vector<DomineeringState> positions(const unsigned count,
+        const unsigned plies) {
+    std::vector<DomineeringState> states;
+    for (unsigned seed = 1; seed <= count; seed++) {
+        std::mt19937 rng(seed);
+        DomineeringState state;
+        for (unsigned p = 0; p < plies; p++) {
+            Bitboard moves = state.movesFor(state.getWho());
+            const unsigned n = moves.count();
+            if (n == 0) {
+                break;
+            }
+            for (unsigned skip = rng() % n; skip > 0; skip--) {
+                moves.pop_lowest();
+            }
+            const unsigned cell = moves.lowest();
+            const unsigned other = state.otherCell(cell, state.getWho());
+            state.makeMove(DomineeringMove(cell / state.COLS,
+                        cell % state.COLS,
+                        other / state.COLS,
+                        other % state.COLS));
+        }
+        states.push_back(state);
+    }
+    return states;
+}
+
+int smp(const unsigned depth,
+        const unsigned max_threads,
+        const unsigned count) {
+    const std::vector<DomineeringState> states = positions(count, 10);
+    Searcher searcher;
+
+    std::cout << "mode  threads     seconds        nodes     knps  speedup"
+        << std::endl;
+    for (const Searcher::Parallel parallel :
+            {Searcher::Parallel::LAZY_SMP, Searcher::Parallel::YBWC}) {
+        searcher.set_parallel(parallel);
+        double base_seconds = 0;
+        for (unsigned threads = 1; threads <= max_threads;
+                threads = threads * 2 > max_threads && threads < max_threads
+                    ? max_threads : threads * 2) {
+            searcher.set_threads(threads);
+            double seconds = 0;
+            unsigned long nodes = 0;
+            // The region solvers outlive a search and remember the shapes
+            // they solved, so the first pass is only there to warm them up
+            // for this configuration; the second one is timed
+            for (const bool timed : {false, true}) {
+                for (const DomineeringState& state : states) {
+                    // Every run starts from an empty table
+                    searcher.reset();
+                    searcher.set_root(Node(state.getWho(), 0));
+
+                    const clock_type::time_point start = clock_type::now();
+                    searcher.iterative_search(state, depth);
+                    if (timed) {
+                        seconds += std::chrono::duration<double>(
+                                clock_type::now() - start).count();
+                        nodes += searcher.get_nodes();
+                    }
+                }
+            }
+            if (threads == 1) {
+                base_seconds = seconds;
+            }
+
+            std::cout << (parallel == Searcher::Parallel::YBWC
+                    ? "ybwc" : "lazy")
+                << std::setw(9) << threads
+                << std::fixed << std::setprecision(3)
+                << std::setw(12) << seconds
+                << std::setw(13) << nodes
+                << std::setprecision(0)
+                << std::setw(9) << nodes / seconds / 1000
+                << std::setprecision(2)
+                << std::setw(9) << base_seconds / seconds
+                << std::endl;
+        }
+    }
+
+    searcher.cleanup();
+    return 0;
+}
+
+/**
+ * Score of a move for HOME: the alpha-beta score of the position after it,
+ * searched one ply less deep.
+ *
+ * \param[in] searcher the searcher to use; its algorithm is changed.
+ *
+ * \param[in] state the position the move is played in.
+ *
+ * \param[in] move the move.
+ *
+ * \param[in] depth the depth the move was found at.
+ */
+Evaluator::score_t move_score(Searcher& searcher,
+        const DomineeringState& state,
+        const Location& move,
+        const unsigned depth) {
+    DomineeringState child{state};
+    child.makeMove(move.to_move());
+    if (depth <= 1) {
+        return searcher.evaluate(child);
+    }
+
+    searcher.set_algorithm(Searcher::Algorithm::ALPHA_BETA);
+    searcher.reset();
+    searcher.set_root(Node(child.getWho(), 0));
+    return searcher.iterative_search(child, depth - 1).score();
+}
+
+/**
+ * \param[in] report what a searcher reported (see Searcher::set_report).
+ *
+ * \return the first move of the principal variation of the last iteration
+ *         reported, as it is written there (e.g. "1,0h"), or an empty
+ *         string if there is none.
+ */
+std::string reported_move(const std::string& report) {
+    const std::size_t line = report.rfind("search depth");
+    if (line == std::string::npos) {
+        return "";
+    }
+    std::istringstream pv(report.substr(report.find(" pv", line) + 3));
+    std::string move;
+    pv >> move;
+    return move;
+}
+
+/**
+ * \return a move the way Searcher::set_report writes it.
+ */
+std::string reported_move(const Location& move) {
+    std::ostringstream out;
+    out << move.r1 << ',' << move.c1 << (move.r1 != move.r2 ? 'v' : 'h');
+    return out.str();
+}
+
+int search(const unsigned depth, const unsigned count) {
+    // An even and an odd number of plies, so that both sides are to move at
+    // the root
+    std::vector<DomineeringState> states = positions(count - count / 2, 10);
+    for (const DomineeringState& state : positions(count / 2, 11)) {
+        states.push_back(state);
+    }
+    Searcher searcher;
+    searcher.set_threads(1);
+
+    std::cout << "algorithm     seconds        nodes" << std::endl;
+    const std::vector<std::pair<Searcher::Algorithm, std::string>>
+        algorithms{{Searcher::Algorithm::ALPHA_BETA, "alphabeta"},
+                   {Searcher::Algorithm::PVS, "pvs"},
+                   {Searcher::Algorithm::MTDF, "mtdf"}};
+    std::vector<std::vector<Evaluator::score_t>> scores;
+    std::vector<std::vector<Node>> results;
+    std::vector<std::vector<std::string>> pvs;
+    for (const auto& algorithm : algorithms) {
+        searcher.set_algorithm(algorithm.first);
+        scores.emplace_back();
+        results.emplace_back();
+        pvs.emplace_back();
+        double seconds = 0;
+        unsigned long nodes = 0;
+        for (const DomineeringState& state : states) {
+            searcher.reset();
+            searcher.set_root(Node(state.getWho(), 0));
+            std::ostringstream report;
+            searcher.set_report(&report);
+
+            const clock_type::time_point start = clock_type::now();
+            const Node best = searcher.iterative_search(state, depth);
+            seconds += std::chrono::duration<double>(
+                    clock_type::now() - start).count();
+            nodes += searcher.get_nodes();
+            searcher.set_report(nullptr);
+            scores.back().push_back(best.score());
+            results.back().push_back(best);
+            pvs.back().push_back(reported_move(report.str()));
+        }
+
+        std::cout << std::left << std::setw(9) << algorithm.second
+            << std::right << std::fixed << std::setprecision(3)
+            << std::setw(12) << seconds
+            << std::setw(13) << nodes
+            << std::endl;
+    }
+
+    unsigned mismatches = 0;
+    for (std::size_t a = 1; a < algorithms.size(); a++) {
+        for (std::size_t i = 0; i < states.size(); i++) {
+            if (scores[a][i] != scores[0][i]) {
+                std::cout << "position " << i + 1 << ": " << scores[0][i]
+                    << " with " << algorithms[0].second << ", "
+                    << scores[a][i] << " with " << algorithms[a].second
+                    << std::endl;
+                mismatches++;
+            }
+        }
+    }
+
+    // The move played (the head of the principal variation, which
+    // pondering goes on from) has to reach the score found for it
+    for (std::size_t a = 0; a < algorithms.size(); a++) {
+        for (std::size_t i = 0; i < states.size(); i++) {
+            const Node& best = results[a][i];
+            if (best.is_terminal()) {
+                continue;
+            }
+            if (pvs[a][i] != reported_move(best.parent_move)) {
+                std::cout << "position " << i + 1 << ": "
+                    << algorithms[a].second << " plays "
+                    << reported_move(best.parent_move)
+                    << " and reports a line starting with " << pvs[a][i]
+                    << std::endl;
+                mismatches++;
+            }
+            const Evaluator::score_t reached = move_score(searcher,
+                    states[i], best.parent_move, depth);
+            if (reached != best.score()) {
+                std::cout << "position " << i + 1 << ": "
+                    << algorithms[a].second << " plays a move worth "
+                    << reached << " for a score of " << best.score()
+                    << std::endl;
+                mismatches++;
+            }
+        }
+    }
+
+    searcher.cleanup();
+    return mismatches == 0 ? 0 : EXIT_FAILURE;
+}
+
+int endgame(const unsigned plies, const unsigned count) {
+    const std::vector<DomineeringState> states = positions(count, plies);
+    Searcher searcher;
+    searcher.set_threads(1);
+    if (searcher.load_tablebase(Tablebase::default_path())) {
+        std::cout << "Using " << Tablebase::default_path() << std::endl;
+    }
+
+    std::cout << "regions     seconds        nodes" << std::endl;
+    std::vector<Evaluator::score_t> scores[2];
+    for (const bool regions : {false, true}) {
+        searcher.set_regions(regions);
+        double seconds = 0;
+        unsigned long nodes = 0;
+        for (const DomineeringState& state : states) {
+            searcher.reset();
+            searcher.set_root(Node(state.getWho(), 0));
+
+            // Deep enough to play the game out
+            const clock_type::time_point start = clock_type::now();
+            const Node best = searcher.iterative_search(state,
+                    state.getEmpty().count() / 2);
+            seconds += std::chrono::duration<double>(
+                    clock_type::now() - start).count();
+            nodes += searcher.get_nodes();
+            scores[regions].push_back(best.score());
+        }
+
+        std::cout << (regions ? "on " : "off")
+            << std::fixed << std::setprecision(3)
+            << std::setw(16) << seconds
+            << std::setw(13) << nodes
+            << std::endl;
+    }
+
+    unsigned mismatches = 0;
+    for (std::size_t i = 0; i < states.size(); i++) {
+        if (scores[0][i] != scores[1][i]) {
+            std::cout << "position " << i + 1 << ": " << scores[0][i]
+                << " without regions, " << scores[1][i] << " with"
+                << std::endl;
+            mismatches++;
+        }
+    }
+
+    searcher.cleanup();
+    return mismatches == 0 ? 0 : EXIT_FAILURE;
+}
+
+int transpose(const unsigned plies, const unsigned count) {
+    const std::vector<DomineeringState> states = positions(count, plies);
+
+    std::cout << "transposes     seconds   shapes    forms" << std::endl;
+    std::vector<std::string> values[2];
+    for (const bool transposes : {false, true}) {
+        RegionSolver solver(states.front().ROWS, states.front().COLS);
+        solver.use_transposes(transposes);
+
+        const clock_type::time_point start = clock_type::now();
+        for (const DomineeringState& state : states) {
+            const RegionSolver::Decomposition parts =
+                solver.decompose(state.getEmpty());
+            // Form numbers differ between solvers; their options do not
+            values[transposes].push_back(parts.solved
+                    ? solver.to_string(parts.value) : "unsolved");
+        }
+        const double seconds = std::chrono::duration<double>(
+                clock_type::now() - start).count();
+
+        std::cout << (transposes ? "on " : "off")
+            << std::fixed << std::setprecision(3)
+            << std::setw(21) << seconds
+            << std::setw(9) << solver.shape_count()
+            << std::setw(9) << solver.size()
+            << std::endl;
+    }
+
+    unsigned mismatches = 0;
+    for (std::size_t i = 0; i < states.size(); i++) {
+        if (values[0][i] != values[1][i]) {
+            std::cout << "position " << i + 1 << ": " << values[0][i]
+                << " without transposes, " << values[1][i] << " with"
+                << std::endl;
+            mismatches++;
+        }
+    }
+    return mismatches == 0 ? 0 : EXIT_FAILURE;
+}
+
+/**
+ * The features of a position, the way Searcher::evaluate used to find them.
+ */
+EvalBitboard::Features scan_features(const DomineeringState& state) {
+    DomineeringState copy{state};
+    EvalBitboard::Features features;
+    features.home_reserved = home_reserved(&copy);
+    features.home_open = home_open(&copy);
+    clear_marks(&copy);
+    features.away_reserved = away_reserved(&copy);
+    features.away_open = away_open(&copy);
+    return features;
+}
+
+bool same_features(const EvalBitboard::Features& a,
+        const EvalBitboard::Features& b) {
+    return a.home_reserved == b.home_reserved
+        && a.home_open == b.home_open
+        && a.away_reserved == b.away_reserved
+        && a.away_open == b.away_open;
+}
+
+std::ostream& operator<<(std::ostream& out,
+        const EvalBitboard::Features& features) {
+    return out << features.home_reserved << ' ' << features.home_open
+        << ' ' << features.away_reserved << ' ' << features.away_open;
+}
+
+/**
+ * Shows a position the evaluators disagree on.
+ *
+ * \param[in] state the position; shown in full the first time only.
+ *
+ * \param[in] what which evaluators disagree, and where.
+ *
+ * \param[in] expected the features the reference evaluator found.
+ *
+ * \param[in] found the features the other one found.
+ *
+ * \param[in,out] mismatches the number of disagreements so far.
+ */
+void mismatch(const DomineeringState& state,
+        const std::string& what,
+        const EvalBitboard::Features& expected,
+        const EvalBitboard::Features& found,
+        unsigned& mismatches) {
+    if (mismatches == 0) {
+        DomineeringState shown{state};
+        std::cout << shown.toDisplayStr();
+    }
+    std::cout << what << ": " << expected << " expected, " << found
+        << " found" << std::endl;
+    mismatches++;
+}
+
+/**
+ * Random games to the end, the same for the same seed.
+ *
+ * \param[in] count number of games.
+ */
+std::vector<std::vector<Move>> playouts(const unsigned count) {
+    std::vector<std::vector<Move>> games;
+    for (unsigned seed = 1; seed <= count; seed++) {
+        std::mt19937 rng(seed);
+        DomineeringState state;
+        games.emplace_back();
+        while (true) {
+            Bitboard moves = state.movesFor(state.getWho());
+            const unsigned n = moves.count();
+            if (n == 0) {
+                break;
+            }
+            for (unsigned skip = rng() % n; skip > 0; skip--) {
+                moves.pop_lowest();
+            }
+            const Move move(moves.lowest(), state.getWho());
+            state.placeDomino(move.cell(), move.team());
+            state.togglePlayer();
+            games.back().push_back(move);
+        }
+    }
+    return games;
+}
+
+/**
+ * Positions after every number of random plies, from the start to a full
+ * board.
+ *
+ * \param[in] count number of positions per number of plies.
+ */
+std::vector<DomineeringState> every_ply(const unsigned count) {
+    std::vector<DomineeringState> states;
+    const DomineeringState start;
+    for (int plies = 0; plies <= start.ROWS * start.COLS / 2; plies++) {
+        const std::vector<DomineeringState> more = positions(count, plies);
+        states.insert(states.end(), more.begin(), more.end());
+    }
+    return states;
+}
+
+int eval(const unsigned count) {
+    const std::vector<DomineeringState> states = every_ply(count);
+
+    std::cout << "evaluator     ns/eval" << std::endl;
+    std::vector<EvalBitboard::Features> features[2];
+    for (const bool bitboard : {false, true}) {
+        features[bitboard].reserve(states.size());
+        const clock_type::time_point start = clock_type::now();
+        for (const DomineeringState& state : states) {
+            features[bitboard].push_back(bitboard
+                    ? bitboard_eval(state) : scan_features(state));
+        }
+        const double seconds = std::chrono::duration<double>(
+                clock_type::now() - start).count();
+
+        std::cout << (bitboard ? "bitboard" : "scan    ")
+            << std::fixed << std::setprecision(1)
+            << std::setw(12) << seconds * 1e9 / states.size()
+            << std::endl;
+    }
+
+    unsigned mismatches = 0;
+    for (std::size_t i = 0; i < states.size(); i++) {
+        if (!same_features(features[0][i], features[1][i])) {
+            mismatch(states[i], "position " + std::to_string(i + 1),
+                    features[0][i], features[1][i], mismatches);
+        }
+    }
+
+    // The incremental evaluator against the bitboard one, after every move
+    // of random games and after taking every one of them back
+    const std::vector<std::vector<Move>> games = playouts(count);
+    std::size_t moves = 0;
+    for (std::size_t g = 0; g < games.size(); g++) {
+        DomineeringState state;
+        IncrementalEvaluator incremental(state);
+        for (std::size_t i = 0; i <= 2 * games[g].size(); i++) {
+            const bool back = i > games[g].size();
+            const std::size_t ply = back ? 2 * games[g].size() - i : i;
+            if (i > 0) {
+                const Move move = games[g][back ? ply : ply - 1];
+                if (back) {
+                    state.removeDomino(move.cell(), move.team());
+                    incremental.untap(move);
+                }
+                else {
+                    state.placeDomino(move.cell(), move.team());
+                    incremental.tap(move);
+                }
+                state.togglePlayer();
+            }
+            const EvalBitboard::Features expected = bitboard_eval(state);
+            if (!same_features(expected, incremental.features())) {
+                mismatch(state, "game " + std::to_string(g + 1) + " ply "
+                        + std::to_string(ply) + (back ? " (back)" : ""),
+                        expected, incremental.features(), mismatches);
+            }
+        }
+        moves += games[g].size();
+    }
+
+    // A leaf costs a move, the evaluation and taking the move back
+    {
+        const DomineeringState start_state;
+        IncrementalEvaluator incremental(start_state);
+        // Stored so that the evaluations are not optimized away
+        volatile Evaluator::score_t score = 0;
+        const clock_type::time_point start = clock_type::now();
+        for (const std::vector<Move>& game : games) {
+            for (const Move move : game) {
+                incremental.tap(move);
+                score = incremental.score();
+            }
+            for (auto move = game.rbegin(); move != game.rend(); ++move) {
+                incremental.untap(*move);
+            }
+        }
+        const double seconds = std::chrono::duration<double>(
+                clock_type::now() - start).count();
+        static_cast<void>(score);
+        std::cout << "incremental"
+            << std::fixed << std::setprecision(1)
+            << std::setw(9) << seconds * 1e9 / std::max<std::size_t>(moves, 1)
+            << std::endl;
+    }
+
+    std::cout << states.size() << " positions, " << moves << " moves, "
+        << mismatches << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : EXIT_FAILURE;
+}
+
+int kernels(const unsigned count) {
+    const std::vector<DomineeringState> states = every_ply(count);
+    // Each position is short work; repeat so that the clock can tell
+    const unsigned rounds = 20;
+    const BoardKernels reference(BoardKernels::Isa::SCALAR);
+
+    std::cout << "kernel    ns/eval  ns/movegen" << std::endl;
+    unsigned mismatches = 0;
+    for (const BoardKernels::Isa isa : {BoardKernels::Isa::SCALAR,
+            BoardKernels::Isa::SSE2, BoardKernels::Isa::AVX2}) {
+        if (!BoardKernels::supported(isa)) {
+            std::cout << std::left << std::setw(8)
+                << BoardKernels::name(isa) << std::right
+                << "  not supported" << std::endl;
+            continue;
+        }
+        const BoardKernels kernel(isa);
+
+        // Stored so that the work is not optimized away
+        volatile Evaluator::score_t score = 0;
+        clock_type::time_point start = clock_type::now();
+        for (unsigned round = 0; round < rounds; round++) {
+            for (const DomineeringState& state : states) {
+                score = kernel.features(state).score();
+            }
+        }
+        const double eval_seconds = std::chrono::duration<double>(
+                clock_type::now() - start).count();
+        static_cast<void>(score);
+
+        volatile Bitboard::word_t bits = 0;
+        start = clock_type::now();
+        for (unsigned round = 0; round < rounds; round++) {
+            for (const DomineeringState& state : states) {
+                bits = kernel.moves(state, Who::HOME).w[0]
+                    ^ kernel.moves(state, Who::AWAY).w[0];
+            }
+        }
+        const double moves_seconds = std::chrono::duration<double>(
+                clock_type::now() - start).count();
+        static_cast<void>(bits);
+
+        std::cout << std::left << std::setw(8) << BoardKernels::name(isa)
+            << std::right << std::fixed << std::setprecision(1)
+            << std::setw(11) << eval_seconds * 1e9 / rounds / states.size()
+            << std::setw(12)
+            << moves_seconds * 1e9 / rounds / states.size() / 2
+            << std::endl;
+
+        for (std::size_t i = 0; i < states.size(); i++) {
+            const EvalBitboard::Features expected =
+                reference.features(states[i]);
+            const EvalBitboard::Features found = kernel.features(states[i]);
+            if (!same_features(expected, found)) {
+                mismatch(states[i], std::string(BoardKernels::name(isa))
+                        + " position " + std::to_string(i + 1),
+                        expected, found, mismatches);
+            }
+            for (const Who who : {Who::HOME, Who::AWAY}) {
+                if (kernel.moves(states[i], who)
+                        != states[i].movesFor(who)) {
+                    std::cout << BoardKernels::name(isa) << " position "
+                        << i + 1 << ": wrong moves" << std::endl;
+                    mismatches++;
+                }
+            }
+        }
+    }
+
+    std::cout << states.size() << " positions, " << mismatches
+        << " mismatches" << std::endl;
+    return mismatches == 0 ? 0 : EXIT_FAILURE;
+}
+
+int usage() {
+    std::cerr << "usage: bench smp <depth> [max threads] [positions]"
+        << std::endl
+        << "       bench search <depth> [positions]"
+        << std::endl
+        << "       bench endgame <plies> [positions]"
+        << std::endl
+        << "       bench transpose <plies> [positions]"
+        << std::endl
+        << "       bench eval [positions]"
+        << std::endl
+        << "       bench kernels [positions]"
+        << std::endl;
+    return EXIT_FAILURE;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        return usage();
+    }
+    const std::string command{argv[1]};
+
+    if (command == "smp" && argc >= 3) {
+        const unsigned depth = std::atoi(argv[2]);
+        const unsigned max_threads = argc > 3 ? std::atoi(argv[3]) : 4;
+        const unsigned count = argc > 4 ? std::atoi(argv[4]) : 4;
+        return smp(depth, std::max(1u, max_threads), count);
+    }
+    if (command == "search" && argc >= 3) {
+        const unsigned depth = std::atoi(argv[2]);
+        const unsigned count = argc > 3 ? std::atoi(argv[3]) : 8;
+        return search(depth, count);
+    }
+    if (command == "endgame" && argc >= 3) {
+        const unsigned plies = std::atoi(argv[2]);
+        const unsigned count = argc > 3 ? std::atoi(argv[3]) : 8;
+        return endgame(plies, count);
+    }
+    if (command == "transpose" && argc >= 3) {
+        const unsigned plies = std::atoi(argv[2]);
+        const unsigned count = argc > 3 ? std::atoi(argv[3]) : 100;
+        return transpose(plies, count);
+    }
+    if (command == "eval") {
+        const unsigned count = argc > 2 ? std::atoi(argv[2]) : 100;
+        return eval(count);
+    }
+    if (command == "kernels") {
+        const unsigned count = argc > 2 ? std::atoi(argv[2]) : 100;
+        return kernels(count);
+    }
+    return usage();
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,122 @@
+#include "DomineeringState.h"
+#include "Move.h"
+#include "Node.h"
+#include "OpeningBook.h"
+#include "Searcher.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Builds the opening book (see OpeningBook). Run from the build directory so
+ * that the board size is read from config/domineering.txt, and the number of
+ * search threads from config/uccineers.txt (THREADS).
+ *
+ *   book <plies> <seconds> [file]
+ *       Searches every position of the first `plies' plies for `seconds'
+ *       seconds each, and writes the best moves to `file' (default
+ *       config/book.bin). Positions that are the same up to symmetry are
+ *       searched once.
+ */
+
+namespace {
+
+/**
+ * \return every position that is one ply after one of the given positions,
+ *         one per canonical key.
+ */
+std::vector<DomineeringState> next_plies(
+        const std::vector<DomineeringState>& states) {
+    std::vector<DomineeringState> next;
+    std::unordered_set<OpeningBook::key_t> seen;
+
+    for (const DomineeringState& state : states) {
+        const Who who = state.getWho();
+        Bitboard moves = state.movesFor(who);
+        while (moves.any()) {
+            const unsigned cell = moves.pop_lowest();
+            const unsigned other = state.otherCell(cell, who);
+            DomineeringState child{state};
+            child.makeMove(DomineeringMove(cell / state.COLS,
+                        cell % state.COLS,
+                        other / state.COLS,
+                        other % state.COLS));
+            if (!child.hasMoves(child.getWho())) {
+                continue;
+            }
+
+            unsigned symmetry;
+            if (seen.insert(child.getCanonicalKey(symmetry)).second) {
+                next.push_back(child);
+            }
+        }
+    }
+    return next;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        std::cerr << "usage: book <plies> <seconds> [file]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    const unsigned plies = std::atoi(argv[1]);
+    const float seconds = std::atof(argv[2]);
+    const std::string path = argc > 3 ? argv[3] : OpeningBook::default_path();
+
+    std::vector<DomineeringState> states{DomineeringState()};
+    const unsigned rows = states.front().ROWS;
+    const unsigned cols = states.front().COLS;
+
+    Searcher searcher;
+    std::vector<OpeningBook::Entry> entries;
+    for (unsigned ply = 0; ply < plies && !states.empty(); ply++) {
+        std::cout << "Ply " << ply << ": " << states.size() << " positions"
+            << std::endl;
+
+        for (const DomineeringState& state : states) {
+            // The table is kept: neighbouring positions share a lot
+            searcher.set_root(Node(state.getWho(), 0));
+            const Node best = searcher.iterative_search(state, seconds,
+                    seconds);
+
+            unsigned symmetry;
+            OpeningBook::Entry entry;
+            entry.key = state.getCanonicalKey(symmetry);
+            const Location move = Move::from_location(best.parent_move, cols)
+                .transform(symmetry, rows, cols).to_location(cols);
+            entry.r1 = move.r1;
+            entry.c1 = move.c1;
+            entry.r2 = move.r2;
+            entry.c2 = move.c2;
+            entry.depth = searcher.get_depth();
+            entry.padding = 0;
+            entries.push_back(entry);
+        }
+
+        if (ply + 1 < plies) {
+            states = next_plies(states);
+        }
+    }
+    searcher.cleanup();
+
+    if (!OpeningBook::write(path, rows, cols, entries)) {
+        std::cerr << "Could not write " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    OpeningBook book;
+    if (!book.open(path)) {
+        std::cerr << "Could not read back " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << book.size() << " positions to " << path
+        << std::endl;
+    return 0;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */
@@ -0,0 +1,136 @@
+#include "DomineeringState.h"
+#include "RegionSolver.h"
+#include "Tablebase.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+/**
+ * Builds the tablebase of region values (see Tablebase). Run from the build
+ * directory so that the board size is read from config/domineering.txt.
+ *
+ *   tablebase [max cells] [file]
+ *       Solves every region shape with up to `max cells' cells (default
+ *       12) that fits on the board, and writes them to `file' (default
+ *       config/regions.tb).
+ */
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * \return every shape that is one cell bigger than one of the given shapes,
+ *         canonical (a shape and its transpose have opposite values, so
+ *         only one of them is kept), and that fits on the board either way
+ *         round.
+ */
+std::vector<RegionSolver::Shape> grow(
+        const std::vector<RegionSolver::Shape>& shapes,
+        const unsigned rows,
+        const unsigned cols) {
+    std::vector<RegionSolver::Shape> grown;
+    std::unordered_set<std::string> seen;
+
+    for (const RegionSolver::Shape& shape : shapes) {
+        // One empty row and column on every side to grow into
+        RegionSolver::Shape frame;
+        frame.rows = shape.rows + 2;
+        frame.cols = shape.cols + 2;
+        for (unsigned r = 0; r < shape.rows; r++) {
+            frame.row[r + 1] = shape.row[r] << 1;
+        }
+
+        for (unsigned r = 0; r < frame.rows; r++) {
+            for (unsigned c = 0; c < frame.cols; c++) {
+                const std::uint16_t bit = 1 << c;
+                if (frame.row[r] & bit) {
+                    continue;
+                }
+                const bool touches = (frame.row[r] & (bit << 1 | bit >> 1))
+                    || (r > 0 && (frame.row[r - 1] & bit))
+                    || (r + 1 < frame.rows && (frame.row[r + 1] & bit));
+                if (!touches) {
+                    continue;
+                }
+
+                RegionSolver::Shape bigger{frame};
+                bigger.row[r] |= bit;
+                bool transposed;
+                bigger = bigger.trimmed().canonical(transposed);
+                if ((bigger.rows > rows || bigger.cols > cols)
+                        && (bigger.cols > rows || bigger.rows > cols)) {
+                    continue;
+                }
+                if (seen.insert(bigger.key()).second) {
+                    grown.push_back(bigger);
+                }
+            }
+        }
+    }
+    return grown;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    const unsigned max_cells = argc > 1 ? std::atoi(argv[1]) : 12;
+    const std::string path = argc > 2 ? argv[2] : Tablebase::default_path();
+    if (max_cells < 2 || max_cells > RegionSolver::MAX_REGION_CELLS) {
+        std::cerr << "usage: tablebase [max cells] [file]" << std::endl
+            << "       max cells is between 2 and "
+            << RegionSolver::MAX_REGION_CELLS << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Shapes are grown inside a frame that is two cells bigger
+    const DomineeringState state;
+    const unsigned rows = std::min<unsigned>(state.ROWS,
+            RegionSolver::MAX_SIDE - 2);
+    const unsigned cols = std::min<unsigned>(state.COLS,
+            RegionSolver::MAX_SIDE - 2);
+    RegionSolver solver(state.ROWS, state.COLS);
+
+    // The monomino
+    RegionSolver::Shape cell;
+    cell.rows = cell.cols = 1;
+    cell.row[0] = 1;
+    std::vector<RegionSolver::Shape> shapes{cell};
+
+    std::cout << "cells    shapes     forms   seconds" << std::endl;
+    const clock_type::time_point start = clock_type::now();
+    for (unsigned cells = 2; cells <= max_cells; cells++) {
+        shapes = grow(shapes, rows, cols);
+        for (const RegionSolver::Shape& shape : shapes) {
+            solver.value(shape);
+        }
+        std::cout << std::setw(5) << cells
+            << std::setw(10) << shapes.size()
+            << std::setw(10) << solver.size()
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << std::chrono::duration<double>(
+                    clock_type::now() - start).count()
+            << std::endl;
+    }
+
+    if (!solver.save(path)) {
+        std::cerr << "Could not write " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    Tablebase tablebase;
+    if (!tablebase.open(path)) {
+        std::cerr << "Could not read back " << path << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Wrote " << tablebase.size() << " shapes to " << path
+        << std::endl;
+    return 0;
+}
+
+/* vim: tw=78:et:ts=4:sts=4:sw=4 */